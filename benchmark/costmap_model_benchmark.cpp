@@ -0,0 +1,91 @@
+/**
+ * @Filename: costmap_model_benchmark.cpp
+ * Google Benchmark microbenchmarks of the collision checks of CostmapModel
+ * used by the plugin, on random costmaps of a given size and obstacle
+ * density. Built with the plugin only.
+ * You may use, distribute and modify this code under the
+ * terms of the BSD license.
+ */
+
+#include <Dstar_lite_planning/costmap_model.h>
+#include <costmap_2d/cost_values.h>
+
+#include <benchmark/benchmark.h>
+
+#include <stdlib.h>
+#include <vector>
+
+/* void fill(costmap_2d::Costmap2D &costmap, int density)
+ * --------------------------
+ * Lethal cells with the given density (%), 10% of the cells with a
+ * random inflated cost, the rest free.
+ */
+static void fill(costmap_2d::Costmap2D &costmap, int density) {
+
+        srand(costmap.getSizeInCellsX()*1000 + density);
+        for (unsigned int y = 0; y < costmap.getSizeInCellsY(); y++) {
+                for (unsigned int x = 0; x < costmap.getSizeInCellsX(); x++) {
+                        int r = rand() % 100;
+                        unsigned char c = costmap_2d::FREE_SPACE;
+                        if (r < density) c = costmap_2d::LETHAL_OBSTACLE;
+                        else if (r < density + 10) c = 1 + rand() % 252;
+                        costmap.setCost(x, y, c);
+                }
+        }
+}
+
+static void BM_LineCostVisual(benchmark::State &state) {
+
+        int n = state.range(0);
+        costmap_2d::Costmap2D costmap(n, n, 0.05, 0, 0);
+        fill(costmap, state.range(1));
+        base_local_planner::CostmapModel model(costmap);
+
+        // segments of up to 20 cells, the distance the plugin checks
+        std::vector<int> ends;
+        for (int i = 0; i < 1024; i++) {
+                int x = 20 + rand() % (n - 40), y = 20 + rand() % (n - 40);
+                ends.push_back(x);
+                ends.push_back(x + rand() % 41 - 20);
+                ends.push_back(y);
+                ends.push_back(y + rand() % 41 - 20);
+        }
+
+        size_t i = 0;
+        for (auto _ : state) {
+                const int *e = &ends[(i++ & 1023)*4];
+                benchmark::DoNotOptimize(model.lineCostVisual(e[0], e[1], e[2], e[3]));
+        }
+}
+
+static void BM_FootprintCost(benchmark::State &state) {
+
+        int n = state.range(0);
+        costmap_2d::Costmap2D costmap(n, n, 0.05, 0, 0);
+        fill(costmap, state.range(1));
+        base_local_planner::CostmapModel model(costmap);
+
+        // turtlebot sized square footprint
+        std::vector<geometry_msgs::Point> footprint(4);
+        footprint[0].x = -0.2; footprint[0].y = -0.2;
+        footprint[1].x = -0.2; footprint[1].y = 0.2;
+        footprint[2].x = 0.2;  footprint[2].y = 0.2;
+        footprint[3].x = 0.2;  footprint[3].y = -0.2;
+
+        std::vector<geometry_msgs::Point> positions(1024);
+        for (size_t i = 0; i < positions.size(); i++) {
+                positions[i].x = 0.5 + (rand() % (n - 20))*0.05;
+                positions[i].y = 0.5 + (rand() % (n - 20))*0.05;
+        }
+
+        size_t i = 0;
+        for (auto _ : state) {
+                benchmark::DoNotOptimize(model.footprintCost(positions[i++ & 1023], footprint, 0.2, 0.25));
+        }
+}
+
+// map size x obstacle density (%)
+BENCHMARK(BM_LineCostVisual)->ArgsProduct({{64, 256, 1024}, {0, 10, 25}});
+BENCHMARK(BM_FootprintCost)->ArgsProduct({{64, 256, 1024}, {0, 10, 25}});
+
+BENCHMARK_MAIN();
@@ -0,0 +1,727 @@
+/**
+ * @Filename: map_benchmark.cpp
+ * Replanning benchmark of the D* Lite core over the map_server maps of
+ * world/. Runs without ROS.
+ * You may use, distribute and modify this code under the
+ * terms of the BSD license.
+ */
+
+#include <Dstar_lite_planning/Dstarlite.h>
+#include <Dstar_lite_planning/costmap_ingest.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// costmap_2d cost values
+#define COST_LETHAL    254
+#define COST_INSCRIBED 253
+#define COST_UNKNOWN   255
+
+/**
+ * [Map  a map_server map turned into a costmap_2d char map, row 0 at the
+ * bottom as in costmap_2d]
+ */
+struct Map {
+
+        std::string name;
+        int width, height;
+        double resolution;
+        std::vector<unsigned char> cost;
+
+};
+
+/**
+ * [Options  command line of the benchmark, the defaults are the ones of
+ * the turtlebot global costmap]
+ */
+struct Options {
+
+        int connectivity;
+        std::string costType;
+        bool dense;
+        bool tiled;              // dense storage in tiles, see Dstar::setTiled
+        unsigned int seed;
+        int runs;
+        double robotRadius;      // m, inscribed radius
+        double inflationRadius;  // m
+        double costScaling;      // costmap_2d cost_scaling_factor
+        int blobRadius;          // cells, radius of the obstacles added
+        double budget;           // s, deadline of a replan
+        bool scratch;            // time A* and Dijkstra from scratch too
+        double scratchFraction;  // see Dstar::setScratchFraction
+
+};
+
+/**
+ * [Blob  an obstacle added by a scenario, a disc of lethal cells]
+ */
+struct Blob {
+
+        int x, y, r;
+
+};
+
+/**
+ * [Sample  the measures of a single replan]
+ */
+struct Sample {
+
+        double ms;
+        bool found;
+        bool incomplete;         // the replan hit the budget
+        unsigned long expansions;
+        unsigned long heapOps;
+        double pathCost;
+        double astarMs;          // planFromScratch, with --scratch
+        double dijkstraMs;
+        bool scratchMismatch;    // a scratch path cost differs from D* Lite
+        bool scratchCutOff;      // a search was cut off, nothing compared
+
+};
+
+static Options opt;
+
+/* bool readYaml(const std::string &file, std::string &image, double &resolution, ...)
+ * --------------------------
+ * Reads the few keys of a map_server yaml file the benchmark needs. The
+ * image path is relative to the yaml file. The keys missing from the
+ * file leave their argument untouched.
+ */
+static bool readYaml(const std::string &file, std::string &image, double &resolution,
+                     bool &negate, double &occupiedThresh, double &freeThresh) {
+
+        std::ifstream in(file.c_str());
+        if (!in) return false;
+
+        image = "";
+        resolution = 0.05;
+
+        std::string line;
+        while (std::getline(in, line)) {
+                size_t colon = line.find(':');
+                if ((line.empty()) || (line[0] == '#') || (colon == std::string::npos)) continue;
+                std::string key = line.substr(0, colon);
+                std::string value = line.substr(colon + 1);
+                value.erase(0, value.find_first_not_of(" \t"));
+                value.erase(value.find_last_not_of(" \t\r") + 1);
+
+                if (key == "image") image = value;
+                else if (key == "resolution") resolution = atof(value.c_str());
+                else if (key == "negate") negate = (atoi(value.c_str()) != 0);
+                else if (key == "occupied_thresh") occupiedThresh = atof(value.c_str());
+                else if (key == "free_thresh") freeThresh = atof(value.c_str());
+        }
+
+        if (image.empty()) return false;
+        if (image[0] != '/') {
+                size_t slash = file.rfind('/');
+                if (slash != std::string::npos) image = file.substr(0, slash + 1) + image;
+        }
+        return true;
+}
+
+/* std::string pgmToken(std::istream &in)
+ * --------------------------
+ * Next whitespace separated token of a PGM header, skipping comments.
+ */
+static std::string pgmToken(std::istream &in) {
+
+        std::string token;
+        int c;
+        while ((c = in.get()) != EOF) {
+                if (c == '#') {
+                        while (((c = in.get()) != EOF) && (c != '\n')) {}
+                        continue;
+                }
+                if (isspace(c)) {
+                        if (!token.empty()) break;
+                        continue;
+                }
+                token += (char)c;
+        }
+        return token;
+}
+
+/* bool loadMap(const std::string &yaml, Map &map)
+ * --------------------------
+ * Loads a binary PGM map the way map_server and the costmap_2d static
+ * layer do: occupied cells become lethal, free cells free and the others
+ * unknown.
+ */
+static bool loadMap(const std::string &yaml, Map &map) {
+
+        std::string image;
+        bool negate = false;
+        double occupiedThresh = 0.65, freeThresh = 0.196;
+        if (!readYaml(yaml, image, map.resolution, negate, occupiedThresh, freeThresh)) {
+                fprintf(stderr, "Cannot read %s\n", yaml.c_str());
+                return false;
+        }
+
+        std::ifstream in(image.c_str(), std::ios::binary);
+        if (!in || (pgmToken(in) != "P5")) {
+                fprintf(stderr, "%s is not a binary PGM\n", image.c_str());
+                return false;
+        }
+        map.width  = atoi(pgmToken(in).c_str());
+        map.height = atoi(pgmToken(in).c_str());
+        int maxval = atoi(pgmToken(in).c_str());
+        if ((map.width <= 0) || (map.height <= 0) || (maxval <= 0) || (maxval > 255)) {
+                fprintf(stderr, "%s: unsupported PGM\n", image.c_str());
+                return false;
+        }
+
+        std::vector<unsigned char> pixels((size_t)map.width*map.height);
+        in.read((char *)&pixels[0], pixels.size());
+        if (!in) {
+                fprintf(stderr, "%s: truncated PGM\n", image.c_str());
+                return false;
+        }
+
+        size_t slash = yaml.rfind('/');
+        map.name = (slash == std::string::npos) ? yaml : yaml.substr(slash + 1);
+        map.cost.resize(pixels.size());
+        for (int y = 0; y < map.height; y++) {
+                for (int x = 0; x < map.width; x++) {
+                        double v = (double)pixels[(size_t)(map.height - 1 - y)*map.width + x]/maxval;
+                        double occ = negate ? v : 1 - v;
+                        unsigned char c = COST_UNKNOWN;
+                        if (occ > occupiedThresh) c = COST_LETHAL;
+                        else if (occ < freeThresh) c = COST_FREE_SPACE;
+                        map.cost[(size_t)y*map.width + x] = c;
+                }
+        }
+        return true;
+}
+
+/* unsigned char inflationCost(double distance)
+ * --------------------------
+ * Cost at distance (cells) from a lethal cell, as computed by the
+ * costmap_2d inflation layer.
+ */
+static unsigned char inflationCost(double distance, double resolution) {
+
+        if (distance == 0) return COST_LETHAL;
+        double d = distance*resolution;
+        if (d <= opt.robotRadius) return COST_INSCRIBED;
+        if (d > opt.inflationRadius) return COST_FREE_SPACE;
+        double factor = exp(-1.0*opt.costScaling*(d - opt.robotRadius));
+        return (unsigned char)((COST_INSCRIBED - 1)*factor);
+}
+
+/* void inflate(Map &map, int x0, int y0, int x1, int y1)
+ * --------------------------
+ * Raises the cells around the lethal cells of the window [x0,x1[ x
+ * [y0,y1[ to their inflation cost, within the inflation radius.
+ */
+static void inflate(Map &map, int x0, int y0, int x1, int y1) {
+
+        int r = (int)ceil(opt.inflationRadius/map.resolution);
+        std::vector<unsigned char> src(map.cost);
+
+        for (int y = std::max(y0, 0); y < std::min(y1, map.height); y++) {
+                for (int x = std::max(x0, 0); x < std::min(x1, map.width); x++) {
+                        if (src[(size_t)y*map.width + x] != COST_LETHAL) continue;
+                        for (int dy = -r; dy <= r; dy++) {
+                                int ny = y + dy;
+                                if ((ny < 0) || (ny >= map.height)) continue;
+                                for (int dx = -r; dx <= r; dx++) {
+                                        int nx = x + dx;
+                                        if ((nx < 0) || (nx >= map.width)) continue;
+                                        unsigned char &c = map.cost[(size_t)ny*map.width + nx];
+                                        if (c == COST_UNKNOWN) continue;
+                                        unsigned char v = inflationCost(sqrt((double)(dx*dx + dy*dy)), map.resolution);
+                                        if (v > c) c = v;
+                                }
+                        }
+                }
+        }
+}
+
+/* void stamp(Map &map, const Map &base, const std::vector<Blob> &blobs)
+ * --------------------------
+ * The costmap of a scenario: the static map with the blobs added and
+ * inflated.
+ */
+static void stamp(Map &map, const Map &base, const std::vector<Blob> &blobs) {
+
+        map.cost = base.cost;
+
+        for (size_t i = 0; i < blobs.size(); i++) {
+                const Blob &b = blobs[i];
+                for (int y = b.y - b.r; y <= b.y + b.r; y++) {
+                        for (int x = b.x - b.r; x <= b.x + b.r; x++) {
+                                if ((x < 0) || (y < 0) || (x >= map.width) || (y >= map.height)) continue;
+                                if ((x - b.x)*(x - b.x) + (y - b.y)*(y - b.y) > b.r*b.r) continue;
+                                map.cost[(size_t)y*map.width + x] = COST_LETHAL;
+                        }
+                }
+        }
+        for (size_t i = 0; i < blobs.size(); i++) {
+                const Blob &b = blobs[i];
+                inflate(map, b.x - b.r, b.y - b.r, b.x + b.r + 1, b.y + b.r + 1);
+        }
+}
+
+/* void largestComponent(const Map &map, std::vector<int> &cells)
+ * --------------------------
+ * Cells of the largest 4-connected set of traversable cells, where the
+ * start and goal cells of the scenarios are drawn.
+ */
+static void largestComponent(const Map &map, std::vector<int> &cells) {
+
+        std::vector<int> label(map.cost.size(), -1);
+        std::vector<int> stack, component;
+        int n = 0;
+
+        cells.clear();
+        for (size_t i = 0; i < map.cost.size(); i++) {
+                if ((label[i] >= 0) || (CostmapIngest::translateCost(map.cost[i]) < 0)) continue;
+
+                component.clear();
+                stack.push_back((int)i);
+                label[i] = n;
+                while (!stack.empty()) {
+                        int c = stack.back();
+                        stack.pop_back();
+                        component.push_back(c);
+                        int x = c % map.width, y = c / map.width;
+                        int nb[4][2] = { {x+1,y}, {x-1,y}, {x,y+1}, {x,y-1} };
+                        for (int k = 0; k < 4; k++) {
+                                int nx = nb[k][0], ny = nb[k][1];
+                                if ((nx < 0) || (ny < 0) || (nx >= map.width) || (ny >= map.height)) continue;
+                                int j = ny*map.width + nx;
+                                if ((label[j] >= 0) || (CostmapIngest::translateCost(map.cost[j]) < 0)) continue;
+                                label[j] = n;
+                                stack.push_back(j);
+                        }
+                }
+                if (component.size() > cells.size()) cells.swap(component);
+                n++;
+        }
+}
+
+/* double pathCost(const Map &map, const list<Node> &path, bool freeStart)
+ * --------------------------
+ * Cost of a path in planner units: the length of every move times the
+ * planner cost of the cell it leaves. With freeStart the start cell costs
+ * 1, as in the planner which always takes the robot cell as free. A cell
+ * off the map, where a --hash planner may go, costs 1 too, as a cell the
+ * planner never got a cost for.
+ */
+static double pathCost(const Map &map, const list<Node> &path, bool freeStart = false) {
+
+        double c = 0;
+        list<Node>::const_iterator prev = path.begin(), it;
+        if (prev == path.end()) return 0;
+        for (it = prev, ++it; it != path.end(); prev = it, ++it) {
+                int dx = it->x - prev->x, dy = it->y - prev->y;
+                bool onMap = (prev->x >= 0) && (prev->x < map.width) && (prev->y >= 0) && (prev->y < map.height);
+                double cell = onMap ? CostmapIngest::translateCost(map.cost[(size_t)prev->y*map.width + prev->x]) : 1;
+                if (freeStart && (prev == path.begin())) cell = 1;
+                c += sqrt((double)(dx*dx + dy*dy))*cell;
+        }
+        return c;
+}
+
+/**
+ * [Robot  drives a planner the way SrlDstarLite::plan does: start and
+ * goal updates, incremental costmap ingest, replan]
+ */
+struct Robot {
+
+        DstarBase *planner;
+        CostmapIngest ingest;
+        int sx, sy, gx, gy;
+        int lastSx, lastSy, lastGx, lastGy;
+
+        Robot(const Map &map) {
+                planner = makeDstar(opt.connectivity, opt.costType);
+                planner->setTiled(opt.tiled);
+                planner->setGridSize(opt.dense ? map.width : 0, opt.dense ? map.height : 0);
+                planner->init(0, 0, 1, 1);
+                planner->setScratchFraction(opt.scratchFraction);
+                lastSx = lastSy = lastGx = lastGy = -1;
+        }
+
+        ~Robot() {
+                delete planner;
+        }
+
+        Sample plan(const Map &map) {
+                Sample s;
+                std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+
+                planner->updateStart(sx, sy);
+                planner->updateGoal(gx, gy);
+                if ((sx != lastSx) || (sy != lastSy)) ingest.touch(lastSx, lastSy);
+                if ((gx != lastGx) || (gy != lastGy)) ingest.touch(lastGx, lastGy);
+                lastSx = sx; lastSy = sy; lastGx = gx; lastGy = gy;
+                ingest.ingest(&map.cost[0], map.width, map.height, planner);
+                PlanStatus status = planner->replanFor(opt.budget);
+                s.found = (status == PLAN_FOUND);
+                s.incomplete = (status == PLAN_INCOMPLETE);
+
+                s.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+                SearchStats st = planner->getStats();
+                s.expansions = st.expansions;
+                s.heapOps = st.heapPushes + st.heapUpdates + st.heapRemoves;
+                s.pathCost = s.found ? pathCost(map, planner->getPath()) : 0;
+
+                s.astarMs = s.dijkstraMs = 0;
+                s.scratchMismatch = s.scratchCutOff = false;
+                if (opt.scratch) {
+                        s.astarMs = scratch(map, ENGINE_ASTAR, s);
+                        s.dijkstraMs = scratch(map, ENGINE_DIJKSTRA, s);
+                }
+                return s;
+        }
+
+        // time of a search from scratch on the costs of the last replan,
+        // under the same budget, whose path is checked against the one of
+        // D* Lite when neither search was cut off
+        double scratch(const Map &map, SearchEngine engine, Sample &s) {
+                list<Node> path;
+                SearchStats work;
+                std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+                PlanStatus status = planner->planFromScratch(engine, path, work, opt.budget);
+                double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+                if (s.incomplete || (status == PLAN_INCOMPLETE)) {
+                        s.scratchCutOff = true;
+                        return ms;
+                }
+                bool found = (status == PLAN_FOUND);
+                double ref = pathCost(map, planner->getPath(), true);
+                if (found != s.found || fabs(pathCost(map, path, true) - ref) > 1e-6*ref)
+                        s.scratchMismatch = true;
+                return ms;
+        }
+
+};
+
+/* void report(const Map &map, const char *scenario, std::vector<Sample> &samples)
+ * --------------------------
+ * Prints the latency percentiles and the mean work of the replans of a
+ * scenario, one line per scenario.
+ */
+static void report(const Map &map, const char *scenario, std::vector<Sample> &samples) {
+
+        if (samples.empty()) return;
+
+        std::vector<double> ms;
+        double expansions = 0, heapOps = 0, cost = 0;
+        double dstarMs = 0, astarMs = 0, dijkstraMs = 0;
+        int found = 0, mismatches = 0, cutOff = 0;
+        for (size_t i = 0; i < samples.size(); i++) {
+                ms.push_back(samples[i].ms);
+                dstarMs += samples[i].ms;
+                astarMs += samples[i].astarMs;
+                dijkstraMs += samples[i].dijkstraMs;
+                mismatches += samples[i].scratchMismatch;
+                cutOff += samples[i].scratchCutOff;
+                expansions += samples[i].expansions;
+                heapOps += samples[i].heapOps;
+                if (samples[i].found) {
+                        cost += samples[i].pathCost;
+                        found++;
+                }
+        }
+        std::sort(ms.begin(), ms.end());
+        size_t n = ms.size();
+        #define PCT(p) ms[std::min(n - 1, (size_t)ceil((p)*n) - ((p) > 0 ? 1 : 0))]
+
+        printf("%-24s %-8s %5d %5d %9.3f %9.3f %9.3f %9.3f %11.0f %11.0f %11.1f",
+               map.name.c_str(), scenario, (int)n, (int)n - found,
+               PCT(0.5), PCT(0.9), PCT(0.99), ms[n - 1],
+               expansions/n, heapOps/n, found ? cost/found : 0.0);
+        #undef PCT
+
+        // speedup of the incremental replans over the searches from
+        // scratch, on the mean latencies
+        if (opt.scratch) {
+                printf(" %9.3f %9.3f %7.2f %7.2f",
+                       astarMs/n, dijkstraMs/n, astarMs/dstarMs, dijkstraMs/dstarMs);
+                if (mismatches > 0)
+                        fprintf(stderr, "%s %s: %d path costs differ from scratch\n",
+                                map.name.c_str(), scenario, mismatches);
+                if (cutOff > 0)
+                        fprintf(stderr, "%s %s: %d replans with a search cut off at the budget, not compared\n",
+                                map.name.c_str(), scenario, cutOff);
+        }
+        printf("\n");
+}
+
+/* bool drawPair(...)
+ * --------------------------
+ * Draws a start and a goal cell of the component at least a third of the
+ * map diagonal apart.
+ */
+static bool drawPair(const Map &map, const std::vector<int> &cells, int &sx, int &sy, int &gx, int &gy) {
+
+        double minDist = sqrt((double)(map.width*map.width + map.height*map.height))/3;
+        for (int tries = 0; tries < 1000; tries++) {
+                int s = cells[rand() % cells.size()], g = cells[rand() % cells.size()];
+                sx = s % map.width; sy = s / map.width;
+                gx = g % map.width; gy = g / map.width;
+                if (hypot(sx - gx, sy - gy) >= minDist) return true;
+        }
+        return false;
+}
+
+/* bool blockPath(...)
+ * --------------------------
+ * Adds a blob on a random Node of the first half of the current path,
+ * away from the start and the goal.
+ */
+static bool blockPath(const Map &map, Robot &robot, std::vector<Blob> &blobs) {
+
+        const vector<Node> &path = robot.planner->pathCells();
+        int margin = opt.blobRadius + (int)ceil(opt.inflationRadius/map.resolution) + 2;
+        if ((int)path.size() <= 2*margin) return false;
+
+        int k = margin + rand() % std::max(1, (int)path.size()/2 - margin);
+        Blob b = { path[k].x, path[k].y, opt.blobRadius };
+        blobs.push_back(b);
+        return true;
+}
+
+/* void scenarioRandom(const Map &base, const std::vector<int> &cells)
+ * --------------------------
+ * Independent queries between random start and goal cells on the static
+ * map: every query moves the goal, so D* Lite mostly searches anew.
+ */
+static void scenarioRandom(const Map &base, const std::vector<int> &cells) {
+
+        Robot robot(base);
+        std::vector<Sample> samples;
+        for (int i = 0; i < opt.runs; i++) {
+                if (!drawPair(base, cells, robot.sx, robot.sy, robot.gx, robot.gy)) break;
+                samples.push_back(robot.plan(base));
+        }
+        report(base, "random", samples);
+}
+
+/* void scenarioBlocked(const Map &base, const std::vector<int> &cells)
+ * --------------------------
+ * A fixed query where an obstacle appears on the current path before
+ * every replan. The obstacles are cleared once there is no path left.
+ */
+static void scenarioBlocked(const Map &base, const std::vector<int> &cells) {
+
+        Map map = base;
+        Robot robot(base);
+        std::vector<Blob> blobs;
+        std::vector<Sample> samples;
+
+        if (!drawPair(base, cells, robot.sx, robot.sy, robot.gx, robot.gy)) return;
+        robot.plan(map);
+
+        for (int i = 0; i < opt.runs; i++) {
+                if (!blockPath(base, robot, blobs)) blobs.clear();
+                stamp(map, base, blobs);
+                Sample s = robot.plan(map);
+                samples.push_back(s);
+                if (!s.found) {
+                        blobs.clear();
+                        stamp(map, base, blobs);
+                        robot.plan(map);
+                }
+        }
+        report(base, "blocked", samples);
+}
+
+/* void scenarioOpening(const Map &base, const std::vector<int> &cells)
+ * --------------------------
+ * A fixed query whose path is first blocked again and again, then the
+ * obstacles are removed one at a time, newest first, each removal
+ * opening a shorter way. Only the replans after a removal are measured.
+ */
+static void scenarioOpening(const Map &base, const std::vector<int> &cells) {
+
+        Map map = base;
+        Robot robot(base);
+        std::vector<Blob> blobs;
+        std::vector<Sample> samples;
+
+        if (!drawPair(base, cells, robot.sx, robot.sy, robot.gx, robot.gy)) return;
+        robot.plan(map);
+
+        while ((int)samples.size() < opt.runs) {
+                int closed = 0;
+                while ((closed < 10) && blockPath(base, robot, blobs)) {
+                        stamp(map, base, blobs);
+                        if (!robot.plan(map).found) {
+                                blobs.pop_back();
+                                stamp(map, base, blobs);
+                                robot.plan(map);
+                                break;
+                        }
+                        closed++;
+                }
+                if (blobs.empty()) break;
+
+                while (!blobs.empty() && ((int)samples.size() < opt.runs)) {
+                        blobs.pop_back();
+                        stamp(map, base, blobs);
+                        samples.push_back(robot.plan(map));
+                }
+        }
+        report(base, "opening", samples);
+}
+
+/* void scenarioAdvance(const Map &base, const std::vector<int> &cells)
+ * --------------------------
+ * The robot drives along its path a few cells per replan while, now and
+ * then, an obstacle shows up on the path ahead of it. A new query is
+ * drawn once the goal is reached.
+ */
+static void scenarioAdvance(const Map &base, const std::vector<int> &cells) {
+
+        Map map = base;
+        Robot robot(base);
+        std::vector<Blob> blobs;
+        std::vector<Sample> samples;
+        const int step = 3;
+
+        if (!drawPair(base, cells, robot.sx, robot.sy, robot.gx, robot.gy)) return;
+        robot.plan(map);
+
+        while ((int)samples.size() < opt.runs) {
+                const vector<Node> &path = robot.planner->pathCells();
+                if ((int)path.size() <= step + 1) {
+                        blobs.clear();
+                        stamp(map, base, blobs);
+                        if (!drawPair(base, cells, robot.sx, robot.sy, robot.gx, robot.gy)) break;
+                        robot.plan(map);
+                        continue;
+                }
+
+                robot.sx = path[step].x;
+                robot.sy = path[step].y;
+
+                if ((rand() % 4 == 0) && blockPath(base, robot, blobs)) stamp(map, base, blobs);
+
+                Sample s = robot.plan(map);
+                samples.push_back(s);
+                if (!s.found) {
+                        blobs.clear();
+                        stamp(map, base, blobs);
+                        robot.plan(map);
+                }
+        }
+        report(base, "advance", samples);
+}
+
+static void usage(const char *name) {
+
+        fprintf(stderr,
+                "usage: %s [options] map.yaml...\n"
+                "  --connectivity N   4, 8 or 16 (8)\n"
+                "  --cost-type T      double, uint32 or uint16 (double)\n"
+                "  --hash             hash map instead of dense grid storage\n"
+                "  --tiled            dense grid storage in 64x64 tiles allocated\n"
+                "                     on demand\n"
+                "  --runs N           replans measured per scenario (200)\n"
+                "  --seed N           random seed (1)\n"
+                "  --robot-radius M   inscribed radius in meters (0.2)\n"
+                "  --inflation M      inflation radius in meters (0.5)\n"
+                "  --blob N           radius in cells of the added obstacles (3)\n"
+                "  --budget S         deadline of a replan in seconds, a replan\n"
+                "                     still running then counts as failed (10)\n"
+                "  --scratch          also time A* and Dijkstra from scratch on\n"
+                "                     every replan and report the speedup of D* Lite\n"
+                "  --scratch-fraction F\n"
+                "                     replan with A* from scratch when more than F\n"
+                "                     of the cells changed since the last search (0)\n",
+                name);
+}
+
+int main(int argc, char **argv) {
+
+        opt.connectivity = 8;
+        opt.costType = "double";
+        opt.dense = true;
+        opt.tiled = false;
+        opt.seed = 1;
+        opt.runs = 200;
+        opt.robotRadius = 0.2;
+        opt.inflationRadius = 0.5;
+        opt.costScaling = 5.0;
+        opt.blobRadius = 3;
+        opt.budget = 10;
+        opt.scratch = false;
+        opt.scratchFraction = 0;
+
+        std::vector<std::string> maps;
+        for (int i = 1; i < argc; i++) {
+                std::string a = argv[i];
+                bool more = (i + 1 < argc);
+                if ((a == "--connectivity") && more) opt.connectivity = atoi(argv[++i]);
+                else if ((a == "--cost-type") && more) opt.costType = argv[++i];
+                else if (a == "--hash") opt.dense = false;
+                else if (a == "--tiled") opt.tiled = true;
+                else if ((a == "--runs") && more) opt.runs = atoi(argv[++i]);
+                else if ((a == "--seed") && more) opt.seed = atoi(argv[++i]);
+                else if ((a == "--robot-radius") && more) opt.robotRadius = atof(argv[++i]);
+                else if ((a == "--inflation") && more) opt.inflationRadius = atof(argv[++i]);
+                else if ((a == "--blob") && more) opt.blobRadius = atoi(argv[++i]);
+                else if ((a == "--budget") && more) opt.budget = atof(argv[++i]);
+                else if (a == "--scratch") opt.scratch = true;
+                else if ((a == "--scratch-fraction") && more) opt.scratchFraction = atof(argv[++i]);
+                else if ((a.size() > 1) && (a[0] == '-')) {
+                        usage(argv[0]);
+                        return 1;
+                } else maps.push_back(a);
+        }
+        if (maps.empty()) {
+                usage(argv[0]);
+                return 1;
+        }
+
+        DstarBase *check = makeDstar(opt.connectivity, opt.costType);
+        if (check == NULL) {
+                fprintf(stderr, "connectivity %d with cost type %s not supported\n",
+                        opt.connectivity, opt.costType.c_str());
+                return 1;
+        }
+        delete check;
+
+        printf("# connectivity %d, cost type %s, %s storage, seed %u\n",
+               opt.connectivity, opt.costType.c_str(),
+               opt.dense ? (opt.tiled ? "tiled" : "dense") : "hash", opt.seed);
+        printf("%-24s %-8s %5s %5s %9s %9s %9s %9s %11s %11s %11s",
+               "map", "scenario", "runs", "fail", "p50_ms", "p90_ms", "p99_ms", "max_ms",
+               "expansions", "heap_ops", "path_cost");
+        if (opt.scratch) printf(" %9s %9s %7s %7s", "astar_ms", "dijk_ms", "x_astar", "x_dijk");
+        printf("\n");
+
+        for (size_t i = 0; i < maps.size(); i++) {
+                Map base;
+                if (!loadMap(maps[i], base)) return 1;
+                inflate(base, 0, 0, base.width, base.height);
+
+                std::vector<int> cells;
+                largestComponent(base, cells);
+                if (cells.size() < 2) {
+                        fprintf(stderr, "%s: no free space\n", maps[i].c_str());
+                        continue;
+                }
+
+                srand(opt.seed);
+                scenarioRandom(base, cells);
+                scenarioBlocked(base, cells);
+                scenarioOpening(base, cells);
+                scenarioAdvance(base, cells);
+        }
+
+        return 0;
+}
@@ -0,0 +1,375 @@
+/**
+ * @Filename: micro_benchmark.cpp
+ * Google Benchmark microbenchmarks of the hot functions of the D* Lite
+ * core and of the path smoother, on random maps of a given size and
+ * obstacle density. Runs without ROS.
+ *   dstar_micro_benchmark --benchmark_out=base.json --benchmark_out_format=json
+ * You may use, distribute and modify this code under the
+ * terms of the BSD license.
+ */
+
+#include <Dstar_lite_planning/Dstarlite.h>
+#include <Dstar_lite_planning/pathSplineSmoother/pathSplineSmoother.h>
+
+#include <benchmark/benchmark.h>
+
+#include <stdlib.h>
+#include <new>
+#include <vector>
+
+// Every heap allocation of the process goes through these, so that the
+// benchmarks can report the allocations per iteration (getSucc/getPred
+// must not allocate at all). All the replaceable forms of C++11 are
+// replaced, so that no allocation is released by a mismatched function
+static unsigned long allocations = 0;
+
+static void *countedAlloc(size_t n) noexcept {
+        allocations++;
+        return malloc(n ? n : 1);
+}
+
+// out of line: inlined into a delete expression, the free() would be
+// taken for the release of a new'd pointer by the wrong function
+__attribute__((noinline)) static void countedFree(void *p) noexcept {
+        free(p);
+}
+
+void *operator new(size_t n) {
+        void *p = countedAlloc(n);
+        if (p == NULL) throw std::bad_alloc();
+        return p;
+}
+
+void *operator new[](size_t n) {
+        void *p = countedAlloc(n);
+        if (p == NULL) throw std::bad_alloc();
+        return p;
+}
+
+void *operator new(size_t n, const std::nothrow_t &) noexcept {
+        return countedAlloc(n);
+}
+
+void *operator new[](size_t n, const std::nothrow_t &) noexcept {
+        return countedAlloc(n);
+}
+
+void operator delete(void *p) noexcept {
+        countedFree(p);
+}
+
+void operator delete[](void *p) noexcept {
+        countedFree(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+        countedFree(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+        countedFree(p);
+}
+
+void operator delete(void *p, size_t) noexcept {
+        countedFree(p);
+}
+
+void operator delete[](void *p, size_t) noexcept {
+        countedFree(p);
+}
+
+/**
+ * [AllocCounter  allocations made while the benchmark timer runs, to be
+ * paused and resumed together with the timer]
+ */
+struct AllocCounter {
+
+        unsigned long count;
+        unsigned long mark;
+
+        AllocCounter() : count(0), mark(allocations) {}
+        void pause() { count += allocations - mark; }
+        void resume() { mark = allocations; }
+
+        void report(benchmark::State &state) {
+                pause();
+                state.counters["allocs"] = benchmark::Counter((double)count, benchmark::Counter::kAvgIterations);
+        }
+
+};
+
+/**
+ * [DstarProbe  calls the private steps of the search of a DstarT]
+ */
+template <class D>
+struct DstarProbe {
+
+        typedef typename D::NodeKey NodeKey;
+        typedef typename D::Neighbours Neighbours;
+
+        static int computeShortestPath(D &d) {
+                // a far deadline instead of none, which gives up after
+                // maxSteps expansions on the large maps
+                d.beginSearch();
+                return d.computeShortestPath(D::Clock::now() + std::chrono::hours(1));
+        }
+        static bool extractPath(D &d) { return d.extractPath(); }
+        static void updateVertex(D &d, Node u) { d.updateVertex(u); }
+        static NodeKey calculateKey(D &d, Node u) { return d.calculateKey(u); }
+        static void getSucc(D &d, Node u, Neighbours &s) { d.getSucc(u, s); }
+        static void getPred(D &d, Node u, Neighbours &s) { d.getPred(u, s); }
+
+};
+
+/**
+ * [Grid  a random square map, planner costs, -1 occupied. The start is
+ * the bottom left corner, the goal the top right one. Every 16th row and
+ * column is kept free, so that start and goal stay connected at any
+ * density]
+ */
+struct Grid {
+
+        int n;
+        std::vector<double> cost;
+
+        Grid(int size, int density) : n(size), cost((size_t)size*size, 1) {
+                srand(size*1000 + density);
+                for (size_t i = 0; i < cost.size(); i++) {
+                        int r = rand() % 100;
+                        if (i % n % 16 == 1 || i / n % 16 == 1 || i % n == (size_t)n - 2 || i / n == (size_t)n - 2) continue;
+                        if (r < density) cost[i] = -1;
+                        else if (r < density + 10) cost[i] = 1 + rand() % 50;
+                }
+                cost[1*n + 1] = 1;
+                cost[(size_t)(n - 2)*n + n - 2] = 1;
+        }
+
+        Node node(size_t i) const {
+                Node u;
+                u.x = i % n;
+                u.y = i / n;
+                return u;
+        }
+
+        // nodes spread over the map, drawn once so that the loops do not
+        // measure rand()
+        std::vector<Node> sample(size_t count) const {
+                std::vector<Node> nodes;
+                for (size_t i = 0; i < count; i++) nodes.push_back(node(rand() % cost.size()));
+                return nodes;
+        }
+
+};
+
+/* void load(D &d, const Grid &g)
+ * --------------------------
+ * Dense grid storage, start and goal at opposite corners, every
+ * non-free cell sent to the planner. The setups plan with replanFor, as
+ * replan gives up after maxSteps expansions on the large maps.
+ */
+template <class D>
+static void load(D &d, const Grid &g) {
+
+        d.setGridSize(g.n, g.n);
+        d.init(1, 1, g.n - 2, g.n - 2);
+        for (size_t i = 0; i < g.cost.size(); i++) {
+                if (g.cost[i] != 1) d.updateCell(i % g.n, i / g.n, g.cost[i]);
+        }
+}
+
+template <class D>
+static void BM_UpdateCell(benchmark::State &state) {
+
+        Grid g(state.range(0), state.range(1));
+        D d;
+        load(d, g);
+        d.replanFor(3600);
+        std::vector<Node> nodes = g.sample(1024);
+
+        AllocCounter allocs;
+        size_t i = 0;
+        for (auto _ : state) {
+                // blocking then restoring a cell leaves the planner as it was
+                const Node &u = nodes[i++ & 1023];
+                d.updateCell(u.x, u.y, -1);
+                d.updateCell(u.x, u.y, g.cost[(size_t)u.y*g.n + u.x]);
+        }
+        allocs.report(state);
+        state.SetItemsProcessed(2*state.iterations());
+}
+
+template <class D>
+static void BM_UpdateVertex(benchmark::State &state) {
+
+        Grid g(state.range(0), state.range(1));
+        D d;
+        load(d, g);
+        d.replanFor(3600);
+        std::vector<Node> nodes = g.sample(1024);
+
+        AllocCounter allocs;
+        size_t i = 0;
+        for (auto _ : state) {
+                DstarProbe<D>::updateVertex(d, nodes[i++ & 1023]);
+        }
+        allocs.report(state);
+}
+
+template <class D>
+static void BM_ComputeShortestPath(benchmark::State &state) {
+
+        Grid g(state.range(0), state.range(1));
+        AllocCounter allocs;
+        for (auto _ : state) {
+                state.PauseTiming();
+                allocs.pause();
+                D *d = new D();
+                load(*d, g);
+                allocs.resume();
+                state.ResumeTiming();
+
+                benchmark::DoNotOptimize(DstarProbe<D>::computeShortestPath(*d));
+
+                state.PauseTiming();
+                allocs.pause();
+                delete d;
+                allocs.resume();
+                state.ResumeTiming();
+        }
+        allocs.report(state);
+}
+
+template <class D>
+static void BM_ExtractPath(benchmark::State &state) {
+
+        Grid g(state.range(0), state.range(1));
+        D d;
+        load(d, g);
+        d.replanFor(3600);
+
+        AllocCounter allocs;
+        for (auto _ : state) {
+                benchmark::DoNotOptimize(DstarProbe<D>::extractPath(d));
+        }
+        allocs.report(state);
+        state.counters["path"] = (double)d.pathCells().size();
+}
+
+template <class D>
+static void BM_GetSucc(benchmark::State &state) {
+
+        Grid g(state.range(0), state.range(1));
+        D d;
+        load(d, g);
+        std::vector<Node> nodes = g.sample(1024);
+        typename DstarProbe<D>::Neighbours s;
+
+        AllocCounter allocs;
+        size_t i = 0;
+        for (auto _ : state) {
+                DstarProbe<D>::getSucc(d, nodes[i++ & 1023], s);
+                benchmark::DoNotOptimize(s.size);
+        }
+        allocs.report(state);
+}
+
+template <class D>
+static void BM_GetPred(benchmark::State &state) {
+
+        Grid g(state.range(0), state.range(1));
+        D d;
+        load(d, g);
+        std::vector<Node> nodes = g.sample(1024);
+        typename DstarProbe<D>::Neighbours s;
+
+        AllocCounter allocs;
+        size_t i = 0;
+        for (auto _ : state) {
+                DstarProbe<D>::getPred(d, nodes[i++ & 1023], s);
+                benchmark::DoNotOptimize(s.size);
+        }
+        allocs.report(state);
+}
+
+template <class D>
+static void BM_CalculateKey(benchmark::State &state) {
+
+        Grid g(state.range(0), state.range(1));
+        D d;
+        load(d, g);
+        d.replanFor(3600);
+        std::vector<Node> nodes = g.sample(1024);
+
+        AllocCounter allocs;
+        size_t i = 0;
+        for (auto _ : state) {
+                benchmark::DoNotOptimize(DstarProbe<D>::calculateKey(d, nodes[i++ & 1023]));
+        }
+        allocs.report(state);
+}
+
+/* void BM_SmoothWhileDistanceLessThan(benchmark::State &state)
+ * --------------------------
+ * Smooths the path planned on the map the way SrlDstarLite::SmoothPlan
+ * does: 0.05 m cells, 10 points per move, filter then smooth.
+ */
+static void BM_SmoothWhileDistanceLessThan(benchmark::State &state) {
+
+        Grid g(state.range(0), state.range(1));
+        Dstar d;
+        load(d, g);
+        d.replanFor(3600);
+
+        std::vector<RealPoint> input;
+        const vector<Node> &path = d.pathCells();
+        for (vector<Node>::const_iterator it = path.begin(); it != path.end(); ++it) {
+                RealPoint p;
+                p.x = (it->x + 0.5)*0.05;
+                p.y = (it->y + 0.5)*0.05;
+                p.theta = 0;
+                if (!input.empty()) {
+                        RealPoint last = input.back();
+                        for (double t = 0.1; t < 1; t += 0.1) {
+                                RealPoint q;
+                                q.x = (p.x - last.x)*t + last.x;
+                                q.y = (p.y - last.y)*t + last.y;
+                                q.theta = 0;
+                                input.push_back(q);
+                        }
+                }
+                input.push_back(p);
+        }
+
+        PathSplineSmoother smoother;
+        AllocCounter allocs;
+        for (auto _ : state) {
+                smoother.readPathFromStruct(input);
+                smoother.filterPath(1);
+                benchmark::DoNotOptimize(smoother.smoothWhileDistanceLessThan(0.05, 1.01));
+        }
+        allocs.report(state);
+        state.counters["points"] = (double)input.size();
+}
+
+// map size x obstacle density (%)
+#define CHEAP_ARGS ->ArgsProduct({{64, 256, 1024}, {0, 10, 25}})
+#define SEARCH_ARGS ->ArgsProduct({{64, 256, 512}, {0, 10, 25}})->Unit(benchmark::kMillisecond)
+
+typedef DstarT<EightConnected, uint32_t> DstarU32;
+
+BENCHMARK_TEMPLATE(BM_UpdateCell, Dstar) CHEAP_ARGS;
+BENCHMARK_TEMPLATE(BM_UpdateCell, DstarU32) CHEAP_ARGS;
+BENCHMARK_TEMPLATE(BM_UpdateVertex, Dstar) CHEAP_ARGS;
+BENCHMARK_TEMPLATE(BM_UpdateVertex, DstarU32) CHEAP_ARGS;
+BENCHMARK_TEMPLATE(BM_ComputeShortestPath, Dstar) SEARCH_ARGS;
+BENCHMARK_TEMPLATE(BM_ComputeShortestPath, DstarU32) SEARCH_ARGS;
+BENCHMARK_TEMPLATE(BM_ComputeShortestPath, Dstar16) SEARCH_ARGS;
+BENCHMARK_TEMPLATE(BM_ExtractPath, Dstar) SEARCH_ARGS;
+BENCHMARK_TEMPLATE(BM_GetSucc, Dstar) CHEAP_ARGS;
+BENCHMARK_TEMPLATE(BM_GetPred, Dstar) CHEAP_ARGS;
+BENCHMARK_TEMPLATE(BM_GetSucc, Dstar16) CHEAP_ARGS;
+BENCHMARK_TEMPLATE(BM_CalculateKey, Dstar) CHEAP_ARGS;
+BENCHMARK_TEMPLATE(BM_CalculateKey, DstarU32) CHEAP_ARGS;
+BENCHMARK(BM_SmoothWhileDistanceLessThan) SEARCH_ARGS;
+
+BENCHMARK_MAIN();
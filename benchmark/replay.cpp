@@ -0,0 +1,190 @@
+/**
+ * @Filename: replay.cpp
+ * Replays a plan log recorded by the plugin (RECORD_FILE) on the D* Lite
+ * core at full speed, for profiling a mission offline with the inputs it
+ * really had. Runs without ROS.
+ *   perf record build/dstar_replay mission.dlog
+ * You may use, distribute and modify this code under the
+ * terms of the BSD license.
+ */
+
+#include <Dstar_lite_planning/Dstarlite.h>
+#include <Dstar_lite_planning/costmap_ingest.h>
+#include <Dstar_lite_planning/plan_log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+typedef std::chrono::steady_clock Clock;
+
+static void usage(const char *name) {
+
+        fprintf(stderr,
+                "usage: %s [options] log\n"
+                "  --repeat N   replays the log N times (1)\n"
+                "  --budget S   deadline of a replan in seconds, 0 for none\n"
+                "               (the PLANNING_TIME recorded)\n"
+                "  --verbose    one line per plan\n",
+                name);
+}
+
+/* DstarBase *makePlanner(const PlanLogConfig &config)
+ * --------------------------
+ * The planner the plugin made out of its parameters.
+ */
+static DstarBase *makePlanner(const PlanLogConfig &config) {
+
+        DstarBase *d = makeDstar(config.connectivity, config.costType);
+        if (d == NULL) return NULL;
+        d->setTiled(config.tiled);
+        d->setScratchFraction(config.scratchFraction);
+        if (config.anytime) d->setAnytime(config.epsilonStart, config.epsilonStep);
+        d->init(0, 0, 10, 10);
+        return d;
+}
+
+/* PlanStatus replay(DstarBase *d, const PlanLogConfig &config, const double *table,
+ *                   const PlanLogRecord &r, double budget)
+ * --------------------------
+ * Same steps as SrlDstarLite::plan: storage sized from the costmap, start
+ * and goal, the cells that changed translated through the cost table of
+ * the plugin, then the replan of the configured kind. A budget <= 0 is
+ * no deadline, as PLANNING_TIME <= 0 in the plugin. A plan the plugin
+ * reused gets no replan, its cells stay pending in the planner.
+ */
+static PlanStatus replay(DstarBase *d, const PlanLogConfig &config, const double *table,
+                         const PlanLogRecord &r, double budget) {
+
+        if (config.dense) {
+                if (d->getGridWidth() != r.width || d->getGridHeight() != r.height) {
+                        d->setGridSize(r.width, r.height);
+                        d->init(r.startX, r.startY, r.goalX, r.goalY);
+                }
+        } else if (d->getGridWidth() != 0) {
+                d->setGridSize(0, 0);
+                d->init(r.startX, r.startY, r.goalX, r.goalY);
+        }
+
+        d->updateStart(r.startX, r.startY);
+        d->updateGoal(r.goalX, r.goalY);
+
+        for (size_t i = 0; i < r.cells.size(); i++) {
+                int index = r.cells[i].index;
+                d->updateCell(index % r.width, index / r.width, table[r.cells[i].cost]);
+        }
+        if (r.status == PLAN_LOG_REUSED) return PLAN_FOUND;
+
+        // the branch of the plugin: without a deadline, replan and its
+        // maxSteps expansions
+        if (config.anytime) return d->replanAnytime(budget);
+        if (budget > 0) return d->replanFor(budget);
+        return d->replan() ? PLAN_FOUND : PLAN_NO_PATH;
+}
+
+int main(int argc, char **argv) {
+
+        int repeat = 1;
+        double budget = -1;
+        bool verbose = false;
+        std::string file;
+        for (int i = 1; i < argc; i++) {
+                std::string a = argv[i];
+                bool more = (i + 1 < argc);
+                if ((a == "--repeat") && more) repeat = atoi(argv[++i]);
+                else if ((a == "--budget") && more) budget = atof(argv[++i]);
+                else if (a == "--verbose") verbose = true;
+                else if ((a.size() > 1) && (a[0] == '-')) {
+                        usage(argv[0]);
+                        return 1;
+                } else file = a;
+        }
+        if (file.empty()) {
+                usage(argv[0]);
+                return 1;
+        }
+
+        PlanLogConfig config;
+        PlanLogReader reader;
+        if (!reader.open(file, config)) {
+                fprintf(stderr, "%s: not a plan log\n", file.c_str());
+                return 1;
+        }
+        if (budget < 0) budget = config.planningTime;
+
+        double table[256];
+        CostmapIngest::costCurve(table, config.costLethal, config.costScale, config.costExponent);
+
+        printf("# connectivity %d, cost type %s, %s storage, %s, budget %g s\n",
+               config.connectivity, config.costType.c_str(),
+               config.dense ? (config.tiled ? "tiled" : "dense") : "hash",
+               config.anytime ? "anytime" : "incremental", budget);
+
+        // the whole log is read first, the replay does not touch the disk
+        std::vector<PlanLogRecord> records;
+        PlanLogRecord record;
+        while (reader.next(record)) records.push_back(record);
+        if (records.empty()) {
+                fprintf(stderr, "%s: no plan\n", file.c_str());
+                return 1;
+        }
+
+        std::vector<double> ms;
+        unsigned long cells = 0, expansions = 0, differ = 0, reused = 0;
+        Clock::time_point begin = Clock::now();
+
+        for (int k = 0; k < repeat; k++) {
+                DstarBase *d = makePlanner(config);
+                if (d == NULL) {
+                        fprintf(stderr, "connectivity %d with cost type %s not supported\n",
+                                config.connectivity, config.costType.c_str());
+                        return 1;
+                }
+
+                for (size_t i = 0; i < records.size(); i++) {
+                        const PlanLogRecord &r = records[i];
+                        Clock::time_point t0 = Clock::now();
+                        PlanStatus status = replay(d, config, table, r, budget);
+                        cells += r.cells.size();
+                        if (r.status == PLAN_LOG_REUSED) {
+                                reused++;
+                                if (verbose) {
+                                        printf("%6lu start %d %d goal %d %d cells %7lu reused\n",
+                                               (unsigned long)i, r.startX, r.startY, r.goalX, r.goalY,
+                                               (unsigned long)r.cells.size());
+                                }
+                                continue;
+                        }
+                        ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - t0).count());
+
+                        unsigned long length = d->pathCells().size();
+                        expansions += d->getStats().expansions;
+
+                        // the recorded outcome only matches when no deadline
+                        // cut a search short, in either run
+                        bool same = (status == r.status && length == r.pathLength);
+                        if (!same) differ++;
+                        if (verbose) {
+                                printf("%6lu start %d %d goal %d %d cells %7lu status %d path %5lu %8.3f ms%s\n",
+                                       (unsigned long)i, r.startX, r.startY, r.goalX, r.goalY,
+                                       (unsigned long)r.cells.size(), status, length, ms.back(),
+                                       same ? "" : "  (recorded differs)");
+                        }
+                }
+                delete d;
+        }
+
+        double total = std::chrono::duration<double>(Clock::now() - begin).count();
+        std::sort(ms.begin(), ms.end());
+        printf("plans %lu, reused %lu, cells %lu, expansions %lu, %.3f s\n",
+               (unsigned long)ms.size(), reused, cells, expansions, total);
+        if (!ms.empty()) {
+                printf("plan ms p50 %.3f p90 %.3f p99 %.3f max %.3f\n",
+                       ms[ms.size()/2], ms[ms.size()*9/10], ms[ms.size()*99/100], ms.back());
+        }
+        printf("outcome differing from the recorded one: %lu\n", differ);
+        return 0;
+}
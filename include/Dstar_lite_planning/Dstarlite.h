@@ -15,26 +15,28 @@
 #include <stack>
 #include <queue>
 #include <list>
+#include <vector>
+#include <string>
+#include <chrono>
 #include <ext/hash_map>
 
+#include <Dstar_lite_planning/connectivity.h>
+#include <Dstar_lite_planning/cost_traits.h>
+
 
 using namespace std;
 using namespace __gnu_cxx;
 
 /**
- * [Node  a grid with its specific parameters, (x,y) in 2D space,g and rhs, keys
- * see more details in [S. Koenig, 2002]]
+ * [Node  a grid cell, (x,y) in 2D space, its g, rhs and key are kept
+ * apart, see more details in [S. Koenig, 2002]]
  * @param x   [x position]
  * @param y   [y position]
- * @param g   [cost of the path from the start node]
- * @param rhs [min of the predecessor's g(s') + c(s,s')]
- * @param k    [key of the node]
  */
 class Node {
 public:
 int x;
 int y;
-pair<double,double> k;
 
 // Define operator overloading to comparing the Nodes
 bool operator == (const Node &s2) const {
@@ -44,37 +46,72 @@ bool operator == (const Node &s2) const {
 bool operator != (const Node &s2) const {
         return ((x != s2.x) || (y != s2.y));
 }
-// Since keys k1, k2 are double, so we will condiser it are the same with a torlence 0.0001
-bool operator > (const Node &s2) const {
-        if (k.first-0.00001 > s2.k.first) return true;
-        else if (k.first < s2.k.first-0.00001) return false;
-        return k.second > s2.k.second;
-}
 
-bool operator <= (const Node &s2) const {
-        if (k.first < s2.k.first) return true;
-        else if (k.first > s2.k.first) return false;
-        return k.second < s2.k.second + 0.00001;
-}
+};
 
+struct ipoint2 {
+        int x,y;
+};
 
-bool operator < (const Node &s2) const {
-        if (k.first + 0.000001 < s2.k.first) return true;
-        else if (k.first - 0.000001 > s2.k.first) return false;
-        return k.second < s2.k.second;
-}
+/**
+ * [Key  the key [k1;k2] of a Node, see more details in [S. Koenig, 2002].
+ * operator < is the lexicographic order, with k1 compared through
+ * CostTraits::same: with double costs, equal k1 values computed along
+ * different paths may differ by rounding errors and the tie has to be
+ * broken on k2. The OpenList and the planner have to use the same order,
+ * or the top of the list may not be the Node the planner expects]
+ */
+template <class Dist>
+struct Key {
+
+        Dist first;
+        Dist second;
+
+        bool operator < (const Key &k2) const {
+                if (!CostTraits<Dist>::same(first, k2.first)) return first < k2.first;
+                return second < k2.second;
+        }
 
 };
 
-struct ipoint2 {
-        int x,y;
+/**
+ * [NodeInfoT  the state of a cell, with its cost stored as CostT and its
+ * distances as CostTraits<CostT>::Dist]
+ * @param g         [cost of the path to the goal]
+ * @param rhs       [one step lookahead of g]
+ * @param heapIndex [position of the cell in the open list, -1 if not on it]
+ * @param cost      [cost of moving off the cell, CostTraits<CostT>::OCCUPIED
+ *                  if occupied]
+ * @param flags     [CELL_CREATED (flat-array storage only), CELL_CLOSED and
+ *                  CELL_INCONS bits]
+ */
+template <class CostT>
+struct NodeInfoT {
+
+        typedef typename CostTraits<CostT>::Dist Dist;
+
+        Dist g;
+        Dist rhs;
+        int heapIndex;
+        CostT cost;
+        unsigned char flags;
+
 };
 
-struct NodeInfo {
+/**
+ * [NodeSet  fixed size set of the neighbours of a cell, filled by
+ * getSucc/getPred/getNeighbours on the stack instead of a list so that
+ * expanding a node does not allocate]
+ * @param n    [the neighbour Nodes, valid up to size]
+ * @param move [index of the move to n[i] in the connectivity]
+ * @param size [number of neighbours]
+ */
+template <int N>
+struct NodeSet {
 
-        double g;
-        double rhs;
-        double cost;
+        Node n[N];
+        int move[N];
+        int size;
 
 };
 
@@ -86,59 +123,310 @@ size_t operator()(const Node &s) const {
 };
 
 
-typedef priority_queue<Node, vector<Node>, greater<Node> > ds_pq;
-typedef hash_map<Node,NodeInfo, Node_hash, equal_to<Node> > ds_ch;
-typedef hash_map<Node, float, Node_hash, equal_to<Node> > ds_oh;
+/**
+ * [OpenList  binary min-heap on the Node keys. Every entry points to the
+ * heap position stored in the state of its cell, so a Node is at most
+ * once on the list and its key can be updated or the Node removed in
+ * O(log n) without any lookup]
+ */
+template <class K>
+class OpenList {
+
+public:
+
+bool   empty() const;
+size_t size() const;
+const Node &top() const;
+const K &topKey() const;
+const Node &nodeAt(size_t i) const;
+void   setKeyAt(size_t i, const K &k);
+void   heapify();
+void   push(const Node &u, const K &k, int *heapIndex);
+void   update(const Node &u, const K &k, int *heapIndex);
+void   remove(int *heapIndex);
+void   clear();
+
+private:
+
+struct Entry {
+        Node u;
+        K k;
+        int *heapIndex;
+};
 
-class Dstar {
+vector<Entry> heap;
+
+void   place(size_t i, const Entry &e);
+void   siftUp(size_t i);
+void   siftDown(size_t i);
+};
+
+/**
+ * [PlanStatus  outcome of a time bounded replan: a path was found, there
+ * is no path, or the deadline passed before the search completed. An
+ * incomplete search keeps its openList and is resumed by the next call]
+ */
+enum PlanStatus {
+        PLAN_FOUND,
+        PLAN_NO_PATH,
+        PLAN_INCOMPLETE
+};
+
+/**
+ * [SearchStats  work done by the planner between the end of two replans:
+ * the cost updates of the map and the search of the last replan]
+ * @param expansions    [Nodes expanded by computeShortestPath]
+ * @param vertexUpdates [calls to updateVertex]
+ * @param heapPushes    [Nodes put on the openList]
+ * @param heapUpdates   [key changes of Nodes already on the openList]
+ * @param heapRemoves   [Nodes taken off the openList]
+ * @param staleKeys     [Nodes found on top of the openList with an out of
+ *                      date key and put back with the new one]
+ * @param cellsCreated  [cells given their own state by makeNewCell]
+ * @param peakOpenList  [largest size of the openList]
+ * @param cells         [cells with their own state at the end of the
+ *                      replan, the size of cellHash on hash storage]
+ * @param tiles         [tiles allocated at the end of the replan, on
+ *                      tiled storage]
+ * @param searchTime    [seconds spent in computeShortestPath]
+ * @param extractTime   [seconds spent extracting the path]
+ * @param pathReused    [cells of the path taken over from the previous
+ *                      one instead of being walked again]
+ */
+struct SearchStats {
+
+        unsigned long expansions;
+        unsigned long vertexUpdates;
+        unsigned long heapPushes;
+        unsigned long heapUpdates;
+        unsigned long heapRemoves;
+        unsigned long staleKeys;
+        unsigned long cellsCreated;
+        size_t peakOpenList;
+        size_t cells;
+        size_t tiles;
+        double searchTime;
+        double extractTime;
+        unsigned long pathReused;
+
+        SearchStats() : expansions(0), vertexUpdates(0), heapPushes(0), heapUpdates(0),
+                heapRemoves(0), staleKeys(0), cellsCreated(0), peakOpenList(0), cells(0),
+                tiles(0), searchTime(0), extractTime(0), pathReused(0) {}
+
+};
+
+/**
+ * [SearchEngine  the non-incremental searches of planFromScratch: A*
+ * with the free space heuristic of the planner, or Dijkstra without
+ * heuristic]
+ */
+enum SearchEngine {
+        ENGINE_ASTAR,
+        ENGINE_DIJKSTRA
+};
+
+/**
+ * [DstarBase  the planner interface, so that the connectivity and the
+ * cost type can be chosen at run time while every DstarT is compiled for
+ * a single one. Costs are given in planner units, < 0 being occupied]
+ */
+class DstarBase {
+
+public:
+
+virtual ~DstarBase() {}
+virtual void   init(int sX, int sY, int gX, int gY) = 0;
+virtual void   setGridSize(int width, int height) = 0;
+virtual void   setTiled(bool tiled) = 0;
+virtual int    getGridWidth() = 0;
+virtual int    getGridHeight() = 0;
+virtual void   updateCell(int x, int y, double val) = 0;
+virtual void   setCosts(const unsigned char *costs, const double *table, int y, int x0, int n) = 0;
+virtual void   updateStart(int x, int y) = 0;
+virtual void   updateGoal(int x, int y) = 0;
+virtual bool   replan() = 0;
+virtual PlanStatus replanFor(double timeBudget) = 0;
+virtual void   setAnytime(double epsStart, double epsStep) = 0;
+virtual double getEpsilon() = 0;
+virtual PlanStatus replanAnytime(double timeBudget) = 0;
+virtual SearchStats getStats() = 0;
+virtual PlanStatus planFromScratch(SearchEngine engine, list<Node> &scratchPath, SearchStats &work, double timeBudget) = 0;
+virtual void   setScratchFraction(double fraction) = 0;
+virtual list<Node> getPath() = 0;
+virtual const vector<Node> &pathCells() = 0;
+virtual double getCostToGoal(int x, int y) = 0;
+virtual void   getCostField(int x0, int y0, int width, int height, vector<float> &field) = 0;
+};
+
+/**
+ * [DstarT  D* Lite on a grid whose moves are given by the Connectivity
+ * policy (see connectivity.h) and whose cell costs are stored as CostT
+ * (see cost_traits.h). The neighbour loops run over the constant tables
+ * of the policy, so they are unrolled for each connectivity, and integer
+ * cost types give exact distances and key comparisons]
+ */
+template <class Connectivity, class CostT = double>
+class DstarT : public DstarBase {
 
 public:
 
-Dstar(int startX, int startY, int goalX, int goalY);
-Dstar();
+DstarT(int startX, int startY, int goalX, int goalY);
+DstarT();
 void   init(int sX, int sY, int gX, int gY);
+void   setGridSize(int width, int height);
+void   setTiled(bool tiled);
+int    getGridWidth();
+int    getGridHeight();
 void   updateCell(int x, int y, double val);
+void   setCosts(const unsigned char *costs, const double *table, int y, int x0, int n);
 void   updateStart(int x, int y);
 void   updateGoal(int x, int y);
 bool   replan();
+PlanStatus replanFor(double timeBudget);
+void   setAnytime(double epsStart, double epsStep);
+double getEpsilon();
+PlanStatus replanAnytime(double timeBudget);
+SearchStats getStats();
+PlanStatus planFromScratch(SearchEngine engine, list<Node> &scratchPath, SearchStats &work, double timeBudget);
+void   setScratchFraction(double fraction);
 void   draw();
 void   drawCell(Node s,float z);
 
 list<Node> getPath();
+const vector<Node> &pathCells();
+double getCostToGoal(int x, int y);
+void   getCostField(int x0, int y0, int width, int height, vector<float> &field);
 
 private:
 
-list<Node> path;
+// gives the microbenchmarks (benchmark/) access to the single steps of
+// the search
+template <class D> friend struct DstarProbe;
+
+typedef CostTraits<CostT> Traits;
+typedef typename Traits::Dist Dist;
+typedef NodeInfoT<CostT> NodeInfo;
+typedef Key<Dist> NodeKey;
+typedef NodeSet<Connectivity::N> Neighbours;
+typedef hash_map<Node,NodeInfo, Node_hash, equal_to<Node> > ds_ch;
+typedef std::chrono::steady_clock Clock;
 
-double D; // the unit distance between two nodes
-double k_m; // the accumulate key value for every time edge change
+// the path of the last replan, start to goal, and the one before it
+// whose consistent part extractPath takes over. Both keep their capacity
+// from one replan to the next
+vector<Node> path, lastPath;
+
+CostT D; // the cost of an unseen cell
+Dist len[Connectivity::N]; // the length of each move
+Dist k_m; // the accumulate key value for every time edge change
 Node s_start, s_goal, s_last;
 int maxSteps;
 
-priority_queue<Node, vector<Node>, greater<Node> > openList;
-hash_map<Node,NodeInfo, Node_hash, equal_to<Node> > cellHash;
-hash_map<Node, float, Node_hash, equal_to<Node> >  openHash;
+// Anytime D* [M. Likhachev, 2005]: eps inflates the heuristic of the
+// overconsistent Nodes, an overconsistent Node is expanded at most once
+// per search (CLOSED) and the Nodes becoming inconsistent afterwards
+// wait in INCONS for the next search
+double eps, epsStart, epsStep;
+double pathEps; // eps of the search that found the current path
+double keyEps; // eps of the keys on the openList
+bool costsChanged; // a cell cost changed since the last replanAnytime
+vector<Node> closedList, inconsList;
+
+// the last search stopped before s_start was consistent, its openList is
+// kept and the next replan carries on with it
+bool searchSuspended;
+
+SearchStats stats;     // counted since the end of the last replan
+SearchStats lastStats; // returned by getStats
+size_t cellCount;      // cells with their own state
+
+// replan and replanFor answer with A* from scratch instead of repairing
+// the search tree when more than scratchFraction of the cells changed
+// cost since the last search began (0: never), or the goal moved
+double scratchFraction;
+unsigned long changedCells;
+bool goalMoved;
 
-bool   AreSame(double x, double y);
+// state of a cell in planFromScratch, valid when its stamp is the one of
+// the current search
+struct ScratchCell {
+        Dist g;
+        int heapIndex;
+        int move; // move from the parent cell, -1 for s_start
+        unsigned int stamp;
+};
+typedef hash_map<Node,ScratchCell, Node_hash, equal_to<Node> > scratch_ch;
+vector<ScratchCell> scratchGrid;
+unsigned int scratchStamp;
+OpenList<NodeKey> scratchList;
+
+OpenList<NodeKey> openList;
+ds_ch cellHash;
+
+// flat-array storage, used instead of cellHash when gridWidth > 0
+int gridWidth, gridHeight;
+vector<NodeInfo> grid;
+
+// tiled storage (setTiled), used instead of grid: TILE_SIZE x TILE_SIZE
+// tiles of tileCols per row, allocated when one of their cells is
+// created and freed by clearCells. An empty tile has no cell created
+bool tiled;
+int tileCols;
+vector< vector<NodeInfo> > tiles;
+size_t tileCount; // allocated tiles
+
+bool   AreSame(Dist x, Dist y);
+bool   inGrid(const Node &u);
+void   clampToGrid(Node &u);
+NodeInfo *denseCell(const Node &u);
+NodeInfo *newTile(const Node &u);
+NodeInfo *findCell(const Node &u);
+NodeInfo &cellInfo(const Node &u);
+void   clearCells();
 void   makeNewCell(Node u);
-double getG(Node u);
-double getRHS(Node u);
-void   setG(Node u, double g);
-double setRHS(Node u, double rhs);
-double eightCondist(Node a, Node b);
-int    computeShortestPath();
+Dist   getG(Node u);
+Dist   getRHS(Node u);
+void   setG(Node u, Dist g);
+void   setRHS(Node u, Dist rhs);
+int    computeShortestPath(Clock::time_point deadline);
+int    resumeSearch(Clock::time_point deadline);
 void   updateVertex(Node u);
 void   insert(Node u);
 void   remove(Node u);
+void   beginSearch();
+bool   scratchDue();
+PlanStatus replanScratch(double timeBudget);
+ScratchCell &scratchCell(const Node &u, scratch_ch &cells);
+void   retirePath();
+bool   followLastPath(Node &cur);
+bool   extractPath();
+bool   timedExtractPath();
+void   endReplan();
 double trueDist(Node a, Node b);
-double heuristic(Node a, Node b);
-Node  calculateKey(Node u);
-void   getSucc(Node u, list<Node> &s);
-void   getPred(Node u, list<Node> &s);
-double cost(Node a, Node b);
+Dist   heuristic(Node a, Node b);
+NodeKey calculateKey(Node u);
+void   getSucc(Node u, Neighbours &s);
+void   getPred(Node u, Neighbours &s);
+void   getNeighbours(Node u, Neighbours &s);
+void   getSubtree(Node root, list< pair<Node, NodeInfo> > &keep);
+void   setCellCost(Node u, CostT val);
+void   setCost(Node u, CostT val);
+Dist   cost(Node a, int move);
 bool   occupied(Node u);
-bool   isValid(Node u);
-float  keyHashCode(Node u);
+bool   blocked(Node u, int move);
+double costToGoal(Node u, const NodeKey *top);
 };
 
+typedef DstarT<FourConnected>    Dstar4;
+typedef DstarT<EightConnected>   Dstar;
+typedef DstarT<SixteenConnected> Dstar16;
+
+/**
+ * [makeDstar  creates a planner for the given connectivity and cost type]
+ * @param  connectivity [4, 8 or 16]
+ * @param  costType     ["double", "uint32" or "uint16"]
+ * @return              [new planner, NULL for an unknown combination]
+ */
+DstarBase *makeDstar(int connectivity, const std::string &costType = "double");
+
 #endif
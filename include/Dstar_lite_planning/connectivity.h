@@ -0,0 +1,124 @@
+/**
+ * @Filename: connectivity.h
+ * Grid connectivity policies for the D* Lite planner.
+ * You may use, distribute and modify this code under the
+ * terms of the BSD license.
+ */
+#ifndef CONNECTIVITY_H
+#define CONNECTIVITY_H
+
+#include <math.h>
+#include <stdlib.h>
+
+/**
+ * A connectivity policy describes the moves out of a cell:
+ *   N         number of moves
+ *   DX, DY    offset of the neighbour reached by move i
+ *   LENGTH    length of move i, multiplied by the cost of the cell left
+ *   BLOCK     move i is blocked if any neighbour j with bit j set is
+ *             occupied: the neighbour itself and the cells whose corner
+ *             the move cuts
+ *   distance  length of the shortest move sequence covering the offset
+ *             (dx,dy) in free space, given the length len[i] of each
+ *             move in the planner's distance type. It is the heuristic
+ *             of the planner and has to be exact and not only admissible,
+ *             since cells never touched are assumed to have g = rhs =
+ *             distance to the goal
+ */
+
+/**
+ * [FourConnected  only the orthogonal moves, fewer expansions in narrow
+ * aisles]
+ */
+struct FourConnected {
+
+        static const int N = 4;
+        static constexpr int DX[N] = { 0, -1,  0,  1 };
+        static constexpr int DY[N] = {-1,  0,  1,  0 };
+        static constexpr double LENGTH[N] = { 1, 1, 1, 1 };
+        static constexpr unsigned int BLOCK[N] = { 0x1, 0x2, 0x4, 0x8 };
+
+        template <class T>
+        static T distance(int dx, int dy, const T *len) {
+                return (T)(abs(dx) + abs(dy))*len[0];
+        }
+
+};
+
+/**
+ * [EightConnected  orthogonal and diagonal moves, diagonal ones at even
+ * indices. The octile distance is the heuristic]
+ */
+struct EightConnected {
+
+        static const int N = 8;
+        static constexpr int DX[N] = { 1,  0, -1, -1, -1,  0,  1,  1 };
+        static constexpr int DY[N] = {-1, -1, -1,  0,  1,  1,  1,  0 };
+        static constexpr double LENGTH[N] = {
+                M_SQRT2, 1, M_SQRT2, 1, M_SQRT2, 1, M_SQRT2, 1
+        };
+        static constexpr unsigned int BLOCK[N] = {
+                0x83, 0x02, 0x0e, 0x08, 0x38, 0x20, 0xe0, 0x80
+        };
+
+        template <class T>
+        static T distance(int dx, int dy, const T *len) {
+                int min = abs(dx);
+                int max = abs(dy);
+                if (min > max) {
+                        int temp = min;
+                        min = max;
+                        max = temp;
+                }
+                return (T)min*len[0] + (T)(max - min)*len[1];
+        }
+
+};
+
+#define SQRT5 2.23606797749978969641
+
+/**
+ * [SixteenConnected  the 8 moves of EightConnected, at the same indices,
+ * plus the 8 knight moves, which give smoother paths in open space. A
+ * knight move cuts the corners of the orthogonal and the diagonal cell
+ * it passes by]
+ */
+struct SixteenConnected {
+
+        static const int N = 16;
+        static constexpr int DX[N] = {
+                1,  0, -1, -1, -1,  0,  1,  1,
+                2,  1, -1, -2, -2, -1,  1,  2
+        };
+        static constexpr int DY[N] = {
+               -1, -1, -1,  0,  1,  1,  1,  0,
+               -1, -2, -2, -1,  1,  2,  2,  1
+        };
+        static constexpr double LENGTH[N] = {
+                M_SQRT2, 1, M_SQRT2, 1, M_SQRT2, 1, M_SQRT2, 1,
+                SQRT5, SQRT5, SQRT5, SQRT5, SQRT5, SQRT5, SQRT5, SQRT5
+        };
+        static constexpr unsigned int BLOCK[N] = {
+                0x0083, 0x0002, 0x000e, 0x0008, 0x0038, 0x0020, 0x00e0, 0x0080,
+                0x0181, 0x0203, 0x0406, 0x080c, 0x1018, 0x2030, 0x4060, 0x80c0
+        };
+
+        // the shortest path combines the two moves bounding the cone of
+        // (dx,dy): straight and knight moves below slope 1/2, knight and
+        // diagonal moves above
+        template <class T>
+        static T distance(int dx, int dy, const T *len) {
+                int min = abs(dx);
+                int max = abs(dy);
+                if (min > max) {
+                        int temp = min;
+                        min = max;
+                        max = temp;
+                }
+                if (2*min <= max) return (T)min*len[8] + (T)(max - 2*min)*len[1];
+                return (T)(max - min)*len[8] + (T)(2*min - max)*len[0];
+        }
+
+};
+
+#endif
@@ -0,0 +1,115 @@
+/**
+ * @Filename: cost_traits.h
+ * Cost representations of the D* Lite planner.
+ * You may use, distribute and modify this code under the
+ * terms of the BSD license.
+ */
+#ifndef COST_TRAITS_H
+#define COST_TRAITS_H
+
+#include <cmath>
+#include <stdint.h>
+
+/**
+ * CostTraits<T> describes a planner storing the cell costs as T:
+ *   Dist         type of g, rhs and the keys
+ *   INF          infinite distance
+ *   OCCUPIED     cost of a non-traversable cell
+ *   fromDouble   cell cost of a planner cost given as double, < 0 is
+ *                occupied
+ *   toDouble     the inverse of fromDouble
+ *   moveLength   a move length (1, sqrt(2), ...) in Dist units for a
+ *                cell of cost 1
+ *   moveCost     cost of a move of the given length off a cell
+ *   add          sum of two distances, INF stays INF
+ *   inflate      a distance multiplied by a factor >= 1
+ *   same         equality of two distances
+ *   toLength     a distance in lengths of cells of cost 1, INF being
+ *                INFINITY
+ *
+ * double keeps the original floating point planner, with the equality of
+ * distances up to a tolerance. The integer representations store cell
+ * costs as integers and move lengths as fixed point numbers, so that all
+ * the distances and keys are exact integers. They only differ in the size
+ * of the cell cost and so of the per cell state.
+ */
+template <class T>
+struct CostTraits;
+
+template <>
+struct CostTraits<double> {
+
+        typedef double Dist;
+
+        static Dist INF() { return INFINITY; }
+        static double OCCUPIED() { return -1; }
+
+        static double fromDouble(double v) { return v; }
+        static double toDouble(double c) { return c; }
+        static bool   isOccupied(double c) { return c < 0; }
+
+        static Dist moveLength(double length) { return length; }
+        static Dist moveCost(Dist length, double c) { return length*c; }
+        static Dist add(Dist a, Dist b) { return a + b; }
+        static Dist inflate(Dist a, double f) { return a*f; }
+        static bool same(Dist a, Dist b) {
+                if (std::isinf(a) && std::isinf(b)) return true;
+                return (fabs(a-b) < 0.00001);
+        }
+        static double toLength(Dist a) { return a; }
+
+};
+
+/**
+ * [FixedPointCost  integer cell costs, saturating at MAX_COST, and move
+ * lengths with LENGTH_SCALE units per cell. Distances are uint32_t,
+ * UINT32_MAX being infinite]
+ */
+template <class T, uint32_t MAX_COST>
+struct FixedPointCost {
+
+        typedef uint32_t Dist;
+
+        static const uint32_t LENGTH_SCALE = 256;
+
+        static Dist INF() { return UINT32_MAX; }
+        static T OCCUPIED() { return (T)(MAX_COST + 1); }
+
+        static T fromDouble(double v) {
+                if (v < 0) return OCCUPIED();
+                if (v >= MAX_COST) return (T)MAX_COST;
+                return (T)(v + 0.5);
+        }
+        static double toDouble(T c) {
+                return isOccupied(c) ? -1 : (double)c;
+        }
+        static bool isOccupied(T c) { return c > MAX_COST; }
+
+        static Dist moveLength(double length) {
+                return (Dist)(length*LENGTH_SCALE + 0.5);
+        }
+        static Dist moveCost(Dist length, T c) { return length*(Dist)c; }
+        static Dist add(Dist a, Dist b) {
+                uint64_t sum = (uint64_t)a + b;
+                return (sum >= UINT32_MAX) ? UINT32_MAX : (Dist)sum;
+        }
+        static Dist inflate(Dist a, double f) {
+                double v = (double)a*f;
+                return (v >= UINT32_MAX) ? UINT32_MAX : (Dist)v;
+        }
+        static bool same(Dist a, Dist b) { return a == b; }
+        static double toLength(Dist a) {
+                return (a == UINT32_MAX) ? INFINITY : (double)a/LENGTH_SCALE;
+        }
+
+};
+
+// MAX_COST keeps the longest move (sqrt(5)) off a maximal cost cell
+// below 2^32
+template <>
+struct CostTraits<uint32_t> : public FixedPointCost<uint32_t, 0xfffff> {};
+
+template <>
+struct CostTraits<uint16_t> : public FixedPointCost<uint16_t, 0xfffe> {};
+
+#endif
@@ -0,0 +1,139 @@
+/**
+ * @Filename: costmap_ingest.h
+ * Incremental transfer of the costmap char map into the D* Lite planner.
+ * You may use, distribute and modify this code under the
+ * terms of the BSD license.
+ */
+#ifndef COSTMAP_INGEST_H
+#define COSTMAP_INGEST_H
+
+#include <vector>
+
+#include <Dstar_lite_planning/Dstarlite.h>
+#include <Dstar_lite_planning/plan_log.h>
+
+#define COST_POSSIBLY_CIRCUMSCRIBED 128
+#define COST_FREE_SPACE 0 // costmap_2d::FREE_SPACE
+
+/**
+ * [CostmapIngest  keeps a shadow copy of the last char map given to the
+ * planner and forwards only the cells whose cost changed since then, so
+ * that D* Lite does work proportional to the change and not to the map.
+ * Costs are translated through a 256 entry table, translateCost unless
+ * setCostTable changed it]
+ */
+class CostmapIngest {
+
+public:
+
+CostmapIngest();
+
+/**
+ * [translateCost  planner cost of a costmap cell: -1 (occupied) from
+ * COST_POSSIBLY_CIRCUMSCRIBED on, 1 for free space, the raw cost otherwise]
+ * @param  c [costmap cost]
+ * @return   [planner cost]
+ */
+static double translateCost(unsigned char c);
+
+/**
+ * [costCurve  fills a cost table: -1 (occupied) from lethal on, 1 for
+ * free space, max(1, scale*c^exponent) otherwise. lethal 128, scale 1 and
+ * exponent 1 give translateCost]
+ * @param  table    [256 planner costs, indexed by costmap cost]
+ * @param  lethal   [first costmap cost taken as occupied]
+ * @param  scale    [factor of the curve]
+ * @param  exponent [exponent of the curve]
+ */
+static void costCurve(double *table, int lethal, double scale, double exponent);
+
+/**
+ * [setCostTable  translates the costs through table from now on. The cells
+ * already sent keep their cost, reset() sends them again]
+ * @param  table [256 planner costs, indexed by costmap cost]
+ */
+void setCostTable(const double *table);
+
+/**
+ * [cost  planner cost of a costmap cell with the current table]
+ */
+double cost(unsigned char c) const { return table_[c]; }
+
+/**
+ * [reset  forgets the shadow copy, the next ingest forwards every cell.
+ * Has to be called whenever the planner drops its cells]
+ */
+void reset();
+
+/**
+ * [touch  forces the cell (x,y) to be forwarded on the next ingest, e.g.
+ * the former start or goal cell whose update the planner ignored]
+ */
+void touch(int x, int y);
+
+/**
+ * [setRecorder  every cell forwarded from now on is also given to
+ * recorder, NULL to stop recording]
+ */
+void setRecorder(PlanRecorder *recorder);
+
+/**
+ * [trackChanges  keeps the index of every cell whose costmap cost changed
+ * from now on, until clearChanges. Touched cells sent again with the same
+ * cost are not kept]
+ */
+void trackChanges(bool on);
+void clearChanges();
+
+/**
+ * [changes  indices y*width+x of the cells changed since clearChanges]
+ */
+const std::vector<int> &changes() const { return changes_; }
+
+/**
+ * [reloaded  the whole map was sent since clearChanges, changes() does
+ * not list its cells]
+ */
+bool reloaded() const { return reloaded_; }
+
+/**
+ * [ingest  forwards every cell of grid that differs from the shadow copy
+ * to planner->updateCell and updates the shadow copy]
+ * @param  grid    [row-major char map, index y*width+x]
+ * @param  width   [size in cells along x]
+ * @param  height  [size in cells along y]
+ * @param  planner [D* Lite planner]
+ * @return         [number of forwarded cells]
+ */
+int ingest(const unsigned char *grid, int width, int height, DstarBase *planner);
+
+/**
+ * [ingestRect  same as ingest, but only the cells of the rectangle
+ * [x0,x0+w) x [y0,y0+h) are compared, e.g. the patch of a costmap update.
+ * The touched cells are forwarded whatever the rectangle, an empty one
+ * forwards only them]
+ * @param  grid    [row-major char map, index y*width+x]
+ * @param  width   [size in cells along x]
+ * @param  height  [size in cells along y]
+ * @param  x0, y0  [first cell of the rectangle]
+ * @param  w, h    [size of the rectangle, clipped to the map]
+ * @param  planner [D* Lite planner]
+ * @return         [number of forwarded cells]
+ */
+int ingestRect(const unsigned char *grid, int width, int height,
+               int x0, int y0, int w, int h, DstarBase *planner);
+
+private:
+
+double table_[256];
+std::vector<unsigned char> shadow_;
+std::vector<int> touched_;
+int width_, height_;
+PlanRecorder *recorder_;
+bool tracking_, reloaded_;
+std::vector<int> changes_;
+
+void forward(const unsigned char *grid, int index, DstarBase *planner);
+};
+
+#endif
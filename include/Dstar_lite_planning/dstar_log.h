@@ -0,0 +1,27 @@
+/**
+ * @Filename: dstar_log.h
+ * Logging of the ROS-free planning core.
+ * You may use, distribute and modify this code under the
+ * terms of the BSD license.
+ */
+#ifndef DSTAR_LOG_H
+#define DSTAR_LOG_H
+
+#include <stdio.h>
+#include <iostream>
+
+// The core library is built without ROS, so it logs to stderr instead of
+// rosconsole. Debug messages are compiled out unless DSTAR_LOG_DEBUG is
+// defined.
+#define DSTAR_WARN(...)  do { fprintf(stderr, "[ WARN] " __VA_ARGS__); fputc('\n', stderr); } while (0)
+#define DSTAR_ERROR(...) do { fprintf(stderr, "[ERROR] " __VA_ARGS__); fputc('\n', stderr); } while (0)
+
+#ifdef DSTAR_LOG_DEBUG
+#define DSTAR_DEBUG(...) do { fprintf(stderr, "[DEBUG] " __VA_ARGS__); fputc('\n', stderr); } while (0)
+#define DSTAR_DEBUG_STREAM(args) do { std::cerr << "[DEBUG] " << args << std::endl; } while (0)
+#else
+#define DSTAR_DEBUG(...) do {} while (0)
+#define DSTAR_DEBUG_STREAM(args) do {} while (0)
+#endif
+
+#endif
@@ -0,0 +1,136 @@
+/**
+ * @Filename: goal_trees.h
+ * D* Lite search trees shared by all the robots heading to the same goal,
+ * for the planning server (dstar_server).
+ * You may use, distribute and modify this code under the
+ * terms of the BSD license.
+ */
+#ifndef GOAL_TREES_H
+#define GOAL_TREES_H
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <Dstar_lite_planning/Dstarlite.h>
+#include <Dstar_lite_planning/costmap_ingest.h>
+
+/**
+ * [GoalTrees  one D* Lite planner per active goal. D* Lite searches from
+ * the goal, so the tree of a goal answers every start: a query from a
+ * start the tree already settled costs the path extraction only, and a
+ * map change is repaired once per goal, not once per robot. Each planner
+ * has its own CostmapIngest, hence its own shadow of the map, and dense
+ * storage of the whole map, or of the tiles it touched with setTiled:
+ * memory grows with the number of goals, which setMaxGoals bounds]
+ */
+class GoalTrees {
+
+public:
+
+GoalTrees();
+~GoalTrees();
+
+/**
+ * [setPlanner  connectivity and cost type of the planners, see makeDstar.
+ * Drops the trees]
+ * @return [false for an unknown combination, the former one is kept]
+ */
+bool setPlanner(int connectivity, const std::string &costType);
+
+/**
+ * [setTiled  dense storage of the planners in tiles, see DstarBase::setTiled.
+ * Drops the trees]
+ */
+void setTiled(bool tiled);
+
+/**
+ * [setCostTable  translation of the map costs, see CostmapIngest. The
+ * trees are sent the whole map again]
+ * @param  table [256 planner costs, indexed by costmap cost]
+ */
+void setCostTable(const double *table);
+
+/**
+ * [setMaxGoals  the least recently queried tree is dropped when a new goal
+ * would make more than n]
+ */
+void setMaxGoals(size_t n);
+
+/**
+ * [setMap  copies a whole char map. The trees are dropped if its size
+ * changed, otherwise they compare the whole map at their next update]
+ * @param  grid   [row-major char map, index y*width+x]
+ */
+void setMap(const unsigned char *grid, int width, int height);
+
+/**
+ * [updateMap  copies the rectangle [x0,x0+w) x [y0,y0+h) of the map,
+ * clipped to it. The trees compare it at their next update]
+ * @param  patch [row-major costs of the rectangle, index y*w+x]
+ */
+void updateMap(const unsigned char *patch, int x0, int y0, int w, int h);
+
+/**
+ * [plan  path from start to goal on the tree of goal, created for the
+ * first query of a goal. The map changes not yet sent to the tree are
+ * sent first]
+ * @param  budget [seconds of search, <= 0 for none. A search stopped by
+ *                the deadline is resumed by the next plan or repair of
+ *                the tree]
+ * @param  path   [cells from start to goal, empty without a path]
+ * @return        [outcome of the replan]
+ */
+PlanStatus plan(int startX, int startY, int goalX, int goalY, double budget, std::vector<Node> &path);
+
+/**
+ * [repair  sends the map changes to every tree and replans it from the
+ * start of its last query, so that the next queries find it up to date]
+ * @param  budget [seconds of search per tree, <= 0 for none]
+ * @return        [number of trees replanned]
+ */
+int repair(double budget);
+
+/**
+ * [dropIdle  drops the trees not queried for idle seconds]
+ * @return [number of trees dropped]
+ */
+size_t dropIdle(double idle);
+
+size_t size() const;
+int width() const;
+int height() const;
+
+private:
+
+typedef std::chrono::steady_clock Clock;
+
+struct Tree {
+        DstarBase *planner;
+        CostmapIngest ingest;
+        int goalX, goalY;
+        int startX, startY;     // of the last query
+        int x0, y0, x1, y1;     // cells changed since the last ingest, none if x0 >= x1
+        Clock::time_point used; // last query
+};
+
+std::vector<Tree*> trees_;
+std::vector<unsigned char> grid_;
+int width_, height_;
+double table_[256];
+int connectivity_;
+std::string costType_;
+bool tiled_;
+size_t maxGoals_;
+
+Tree *tree(int startX, int startY, int goalX, int goalY);
+void drop(size_t i);
+void dropOldest();
+void clear();
+void touchAll();
+void ingest(Tree &t);
+PlanStatus replan(Tree &t, double budget);
+bool inMap(int x, int y) const;
+};
+
+#endif
@@ -28,7 +28,7 @@ PathSplineSmoother::PathSplineSmoother(double sigma)
 {
 								if(sigma >= 1 || sigma <= 0)
 								{
-																ROS_WARN("PathSplineSmoother : [warning] Input sigma is invalid, setting default value...");
+																DSTAR_WARN("PathSplineSmoother : [warning] Input sigma is invalid, setting default value...");
 																sigma_ = defSigma_;
 								}
 								else sigma_ = sigma;
@@ -48,7 +48,7 @@ void PathSplineSmoother::setSigma(double sigma)
 {
 								if(sigma >= 1 || sigma <= 0)
 								{
-																ROS_WARN("PathSplineSmoother : [warning] Input sigma is invalid, keeping the old sigma value...");
+																DSTAR_WARN("PathSplineSmoother : [warning] Input sigma is invalid, keeping the old sigma value...");
 								}
 								else sigma_ = sigma;
 }
@@ -97,7 +97,7 @@ bool PathSplineSmoother::readPathFromFile(string fileName)
 								}
 								else
 								{
-																ROS_ERROR(" PathSplineSmoother : [ERROR] Cannot open input file. Path reading failed.");
+																DSTAR_ERROR(" PathSplineSmoother : [ERROR] Cannot open input file. Path reading failed.");
 																return false;
 								}
 
@@ -107,33 +107,33 @@ bool PathSplineSmoother::readPathFromFile(string fileName)
 void PathSplineSmoother::printOriginalPath()
 {
 								int l = path_.size();
-								ROS_DEBUG(" PathSplineSmoother :  Original path is:");
-								ROS_DEBUG("PathSplineSmoother : x, y, theta");
+								DSTAR_DEBUG(" PathSplineSmoother :  Original path is:");
+								DSTAR_DEBUG("PathSplineSmoother : x, y, theta");
 								for(int i = 0; i<l; i++)
 								{
-																ROS_DEBUG("(%f, %f, %f)", path_.at(i).x, path_.at(i).y, path_.at(i).theta);
+																DSTAR_DEBUG("(%f, %f, %f)", path_.at(i).x, path_.at(i).y, path_.at(i).theta);
 								}
 }
 
 void PathSplineSmoother::printFilteredPath()
 {
 								int l = pathC_.size();
-								ROS_DEBUG("PathSplineSmoother : Filtered path is:");
-								ROS_DEBUG("PathSplineSmoother : x, y, theta");
+								DSTAR_DEBUG("PathSplineSmoother : Filtered path is:");
+								DSTAR_DEBUG("PathSplineSmoother : x, y, theta");
 								for(int i = 0; i<l; i++)
 								{
-																ROS_DEBUG("(%f, %f, %f)", pathC_.at(i).x, pathC_.at(i).y, pathC_.at(i).theta);
+																DSTAR_DEBUG("(%f, %f, %f)", pathC_.at(i).x, pathC_.at(i).y, pathC_.at(i).theta);
 								}
 }
 
 void PathSplineSmoother::printSmoothPath()
 {
 								int l = pathS_.size();
-								ROS_DEBUG("PathSplineSmoother : Smooth path is:");
-								ROS_DEBUG("PathSplineSmoother : x, y, theta");
+								DSTAR_DEBUG("PathSplineSmoother : Smooth path is:");
+								DSTAR_DEBUG("PathSplineSmoother : x, y, theta");
 								for(int i = 0; i<l; i++)
 								{
-																ROS_DEBUG("(%f, %f, %f)", pathS_.at(i).x, pathS_.at(i).y, pathS_.at(i).theta);
+																DSTAR_DEBUG("(%f, %f, %f)", pathS_.at(i).x, pathS_.at(i).y, pathS_.at(i).theta);
 
 								}
 }
@@ -176,7 +176,7 @@ bool PathSplineSmoother::filterPath(double p)
 								{
 																if(N<5)
 																{
-																								ROS_WARN("PathSplineSmoother : [Warning] Path is too short for filtering, running placeAdditionalPoints(0.2) instead.");
+																								DSTAR_WARN("PathSplineSmoother : [Warning] Path is too short for filtering, running placeAdditionalPoints(0.2) instead.");
 																								placeAdditionalPoints(0.2);
 																								return true;
 																}
@@ -225,7 +225,7 @@ bool PathSplineSmoother::filterPath(double p)
 
 																if(M<5)
 																{
-																								ROS_WARN("PathSplineSmoother : [Warning] Path is too short for filtering, running placeAdditionalPoints(0.2) instead.");
+																								DSTAR_WARN("PathSplineSmoother : [Warning] Path is too short for filtering, running placeAdditionalPoints(0.2) instead.");
 																								placeAdditionalPoints(0.2);
 																}
 
@@ -233,7 +233,7 @@ bool PathSplineSmoother::filterPath(double p)
 								}
 								else
 								{
-																ROS_ERROR("PathSplineSmoother : [ERROR] The stored input path is empty. Path filtering failed.");
+																DSTAR_ERROR("PathSplineSmoother : [ERROR] The stored input path is empty. Path filtering failed.");
 																return false;
 								}
 }
@@ -246,7 +246,7 @@ bool PathSplineSmoother::placeAdditionalPoints(double p)
 								{
 																if(N<5 && p>0.2)
 																{
-																								ROS_ERROR("PathSplineSmoother : [Warning] Path is too short, for correct smoothing running placeAdditionalPoints(0.2).");
+																								DSTAR_ERROR("PathSplineSmoother : [Warning] Path is too short, for correct smoothing running placeAdditionalPoints(0.2).");
 																								p = 0.2;
 																}
 
@@ -309,7 +309,7 @@ bool PathSplineSmoother::placeAdditionalPoints(double p)
 								}
 								else
 								{
-																ROS_ERROR("PathSplineSmoother : [ERROR] The stored input path is empty. Path filtering failed.");
+																DSTAR_ERROR("PathSplineSmoother : [ERROR] The stored input path is empty. Path filtering failed.");
 																return false;
 								}
 }
@@ -343,7 +343,7 @@ bool PathSplineSmoother::isPathLine(std::vector<RealPoint> path)
 								}
 								else
 								{
-																ROS_ERROR("PathSplineSmoother :[ERROR] Function input is empty. Path checking failed.");
+																DSTAR_ERROR("PathSplineSmoother :[ERROR] Function input is empty. Path checking failed.");
 																return false;
 								}
 }
@@ -356,7 +356,7 @@ bool PathSplineSmoother::smoothPath()
 								{
 																if(isPathLine(getFilteredPath()))
 																{
-																								ROS_DEBUG("PathSplineSmoother : [Warning] Path is a line. Skipping smoothing.");
+																								DSTAR_DEBUG("PathSplineSmoother : [Warning] Path is a line. Skipping smoothing.");
 																								pathS_ = pathC_;
 																								return true;
 																}
@@ -407,14 +407,14 @@ bool PathSplineSmoother::smoothPath()
 								}
 								else if(M>0)
 								{
-																ROS_WARN("PathSplineSmoother : [Warning] Path is too short, correct smoothing is impossible.");
+																DSTAR_WARN("PathSplineSmoother : [Warning] Path is too short, correct smoothing is impossible.");
 																pathS_ = pathC_;
 
 																return true;
 								}
 								else
 								{
-																ROS_WARN("PathSplineSmoother : [ERROR] The stored filtered path is empty. Please filter the path before smoothing.");
+																DSTAR_WARN("PathSplineSmoother : [ERROR] The stored filtered path is empty. Please filter the path before smoothing.");
 																return false;
 								}
 }
@@ -482,7 +482,7 @@ bool PathSplineSmoother::smoothPath2D()
 								{
 																if(isPathLine(getFilteredPath()))
 																{
-																								ROS_WARN("PathSplineSmoother : [Warning] Path is a line. Skipping smoothing.");
+																								DSTAR_WARN("PathSplineSmoother : [Warning] Path is a line. Skipping smoothing.");
 																								pathS_ = pathC_;
 																								return true;
 																}
@@ -618,14 +618,14 @@ bool PathSplineSmoother::smoothPath2D()
 								}
 								else if(n>0)
 								{
-																ROS_WARN("PathSplineSmoother : [Warning] Path is too short, correct smoothing is impossible.");
+																DSTAR_WARN("PathSplineSmoother : [Warning] Path is too short, correct smoothing is impossible.");
 																pathS_ = pathC_;
 
 																return true;
 								}
 								else
 								{
-																ROS_ERROR("PathSplineSmoother : [ERROR] The stored filtered path is empty. Please filter the path before smoothing.");
+																DSTAR_ERROR("PathSplineSmoother : [ERROR] The stored filtered path is empty. Please filter the path before smoothing.");
 																return false;
 								}
 }
@@ -634,7 +634,7 @@ bool PathSplineSmoother::smoothWhileDistanceLessThan(double max_displacement, do
 {
 								if(sigma_div <= 1)
 								{
-																ROS_ERROR("PathSplineSmoother : [ERROR] Input sigma_div <= 1 is invalid, smoothing failed.");
+																DSTAR_ERROR("PathSplineSmoother : [ERROR] Input sigma_div <= 1 is invalid, smoothing failed.");
 																return false;
 								}
 
@@ -644,7 +644,7 @@ bool PathSplineSmoother::smoothWhileDistanceLessThan(double max_displacement, do
 								{
 																if(isPathLine(getFilteredPath()))
 																{
-																								ROS_WARN("PathSplineSmoother : [Warning] Path is a line. Skipping smoothing.");
+																								DSTAR_WARN("PathSplineSmoother : [Warning] Path is a line. Skipping smoothing.");
 																								pathS_ = pathC_;
 																								return true;
 																}
@@ -654,10 +654,10 @@ bool PathSplineSmoother::smoothWhileDistanceLessThan(double max_displacement, do
 																while(true)
 																{
 																								sigma_/=sigma_div;
-																								ROS_DEBUG("PathSplineSmoother : Sigma = %f ", sigma_);
+																								DSTAR_DEBUG("PathSplineSmoother : Sigma = %f ", sigma_);
 																								deleteSmoothPath();
 																								smoothPath2D();
-																								ROS_DEBUG("PathSplineSmoother : Max displacement = %f", maxDisplacement());
+																								DSTAR_DEBUG("PathSplineSmoother : Max displacement = %f", maxDisplacement());
 
 																								if((maxDisplacement() > max_displacement) || (sigma_ < 0.01))
 																								{
@@ -673,14 +673,14 @@ bool PathSplineSmoother::smoothWhileDistanceLessThan(double max_displacement, do
 								}
 								else if(n>0)
 								{
-																ROS_WARN("PathSplineSmoother : [warning] Path is too short, correct smoothing is impossible.");
+																DSTAR_WARN("PathSplineSmoother : [warning] Path is too short, correct smoothing is impossible.");
 																pathS_ = pathC_;
 
 																return true;
 								}
 								else
 								{
-																ROS_ERROR("PathSplineSmoother : [ERROR] The stored filtered path is empty. Please filter the path before smoothing.");
+																DSTAR_ERROR("PathSplineSmoother : [ERROR] The stored filtered path is empty. Please filter the path before smoothing.");
 																return false;
 								}
 }
@@ -689,7 +689,7 @@ bool PathSplineSmoother::smoothWhileSGDistanceLessThan(double max_displacement,
 {
 								if(sigma_div <= 1)
 								{
-																ROS_ERROR("PathSplineSmoother : [ERROR] Input sigma_div <= 1 is invalid, smoothing failed.");
+																DSTAR_ERROR("PathSplineSmoother : [ERROR] Input sigma_div <= 1 is invalid, smoothing failed.");
 																return false;
 								}
 
@@ -699,7 +699,7 @@ bool PathSplineSmoother::smoothWhileSGDistanceLessThan(double max_displacement,
 								{
 																if(isPathLine(getFilteredPath()))
 																{
-																								ROS_WARN("PathSplineSmoother : [Warning] Path is a line. Skipping smoothing.");
+																								DSTAR_WARN("PathSplineSmoother : [Warning] Path is a line. Skipping smoothing.");
 																								pathS_ = pathC_;
 																								return true;
 																}
@@ -709,10 +709,10 @@ bool PathSplineSmoother::smoothWhileSGDistanceLessThan(double max_displacement,
 																while(true)
 																{
 																								sigma_/=sigma_div;
-																								ROS_DEBUG("PathSplineSmoother : Sigma = %f", sigma_);
+																								DSTAR_DEBUG("PathSplineSmoother : Sigma = %f", sigma_);
 																								deleteSmoothPath();
 																								smoothPath();
-																								ROS_DEBUG("PathSplineSmoother : Max displacement = %f", maxDisplacement());
+																								DSTAR_DEBUG("PathSplineSmoother : Max displacement = %f", maxDisplacement());
 																								if((distanceBetweenStartingPoints() > max_displacement) ||
 																											(distanceBetweenEndingPoints() > max_displacement)
 																											|| (sigma_ < 0.01))
@@ -730,14 +730,14 @@ bool PathSplineSmoother::smoothWhileSGDistanceLessThan(double max_displacement,
 								}
 								else if(n>0)
 								{
-																ROS_WARN("PathSplineSmoother : [Warning] Path is too short, correct smoothing is impossible.");
+																DSTAR_WARN("PathSplineSmoother : [Warning] Path is too short, correct smoothing is impossible.");
 																pathS_ = pathC_;
 
 																return true;
 								}
 								else
 								{
-																ROS_ERROR("PathSplineSmoother : [ERROR] The stored filtered path is empty. Please filter the path before smoothing.");
+																DSTAR_ERROR("PathSplineSmoother : [ERROR] The stored filtered path is empty. Please filter the path before smoothing.");
 																return false;
 								}
 }
@@ -750,13 +750,13 @@ bool PathSplineSmoother::fixStartGoalDisplacement(int numPointsToRemove, double
 								{
 																if(distanceBetweenStartingPoints()<max_displacement && distanceBetweenEndingPoints()<max_displacement)
 																{
-																								ROS_WARN("PathSplineSmoother : [Warning] Displacement is below threshold, no fixing required.");
+																								DSTAR_WARN("PathSplineSmoother : [Warning] Displacement is below threshold, no fixing required.");
 																								return true;
 																}
 
 																if(M<=numPointsToRemove*2)
 																{
-																								ROS_DEBUG_STREAM("PathSplineSmoother : Smoothed path length is " << M << ", numPointsToRemove = " << numPointsToRemove
+																								DSTAR_DEBUG_STREAM("PathSplineSmoother : Smoothed path length is " << M << ", numPointsToRemove = " << numPointsToRemove
 																																																																																									<< ", removing " << numPointsToRemove*2 << " points is impossible! Path fixing failed.\n");
 																								return false;
 																}
@@ -791,14 +791,14 @@ bool PathSplineSmoother::fixStartGoalDisplacement(int numPointsToRemove, double
 								}
 								else if(M>0)
 								{
-																ROS_WARN("PathSplineSmoother : [Warning] Path is too short, correct smoothing is impossible.");
+																DSTAR_WARN("PathSplineSmoother : [Warning] Path is too short, correct smoothing is impossible.");
 																pathS_ = pathC_;
 
 																return true;
 								}
 								else
 								{
-																ROS_ERROR("PathSplineSmoother : [ERROR] The stored smooth path is empty. Please smooth the path before fixing.");
+																DSTAR_ERROR("PathSplineSmoother : [ERROR] The stored smooth path is empty. Please smooth the path before fixing.");
 																return false;
 								}
 }
@@ -816,7 +816,7 @@ double PathSplineSmoother::distanceBetweenStartingPoints()
 								}
 								else
 								{
-																ROS_ERROR("PathSplineSmoother : [ERROR] The stored smoothed path is empty. No distance is available.");
+																DSTAR_ERROR("PathSplineSmoother : [ERROR] The stored smoothed path is empty. No distance is available.");
 																return -1;
 								}
 }
@@ -835,7 +835,7 @@ double PathSplineSmoother::distanceBetweenEndingPoints()
 								}
 								else
 								{
-																ROS_ERROR("PathSplineSmoother : [ERROR] The stored smoothed path is empty. No distance is available.");
+																DSTAR_ERROR("PathSplineSmoother : [ERROR] The stored smoothed path is empty. No distance is available.");
 																return -1;
 								}
 }
@@ -859,7 +859,7 @@ double PathSplineSmoother::maxDisplacement()
 								}
 								else
 								{
-																ROS_ERROR("PathSplineSmoother : [ERROR] The stored smoothed path is empty. No distance is available.");
+																DSTAR_ERROR("PathSplineSmoother : [ERROR] The stored smoothed path is empty. No distance is available.");
 																return -1;
 								}
 }
@@ -29,8 +29,7 @@
 #include <math.h>
 
 #include <Dstar_lite_planning/pathSplineSmoother/realPoint.h>
-#include <ros/ros.h>
-#include <ros/console.h>
+#include <Dstar_lite_planning/dstar_log.h>
 
 class PathSplineSmoother
 {
@@ -0,0 +1,149 @@
+/**
+ * @Filename: plan_log.h
+ * Binary log of the inputs given to the D* Lite planner by the plugin,
+ * replayed offline by dstar_replay.
+ * You may use, distribute and modify this code under the
+ * terms of the BSD license.
+ */
+#ifndef PLAN_LOG_H
+#define PLAN_LOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/*
+ * Layout, host byte order:
+ *   "DSTARLOG" u32 version
+ *   'C' u8 connectivity, u8 length + cost type, u8 dense, u8 tiled, u8 anytime,
+ *       f64 epsilon start, f64 epsilon step, f64 planning time,
+ *       f64 scratch fraction, i32 lethal cost, f64 cost scale,
+ *       f64 cost exponent
+ *   'P' i32 width, i32 height, i32 start x, y, i32 goal x, y,
+ *       u32 n, n x (u32 cell index, u8 costmap cost),
+ *       u8 status, u32 path length
+ *   'P' ...
+ * A 'P' record is written per plan, once the replan is over, with the
+ * cells sent to the planner since the previous one. A plan returned
+ * again without a replan has the status PLAN_LOG_REUSED and the cells
+ * of the returned plan as path length.
+ */
+#define PLAN_LOG_VERSION 4
+
+#define PLAN_LOG_REUSED 255     // status of a plan reused by the plugin
+
+/**
+ * [PlanLogConfig  planner parameters of the plugin, see srl_dstar_lite.h]
+ */
+struct PlanLogConfig {
+
+        int connectivity;
+        std::string costType;
+        bool dense;
+        bool tiled;
+        bool anytime;
+        double epsilonStart;
+        double epsilonStep;
+        double planningTime;
+        double scratchFraction;
+        int costLethal;       // see CostmapIngest::costCurve
+        double costScale;
+        double costExponent;
+
+        PlanLogConfig();
+};
+
+/**
+ * [PlanLogCell  a costmap cell sent to the planner, index y*width+x]
+ */
+struct PlanLogCell {
+
+        uint32_t index;
+        unsigned char cost;
+};
+
+/**
+ * [PlanLogRecord  the inputs and outcome of a plan]
+ */
+struct PlanLogRecord {
+
+        int width, height;
+        int startX, startY;
+        int goalX, goalY;
+        std::vector<PlanLogCell> cells;
+        int status;
+        unsigned long pathLength;
+};
+
+/**
+ * [PlanRecorder  writes the plan log, the cells are buffered until the
+ * plan ends so that a record is never left half written]
+ */
+class PlanRecorder {
+
+public:
+
+PlanRecorder();
+~PlanRecorder();
+
+/**
+ * [open  truncates file and writes the header and the configuration]
+ * @return [false if the file cannot be written]
+ */
+bool open(const std::string &file, const PlanLogConfig &config);
+void close();
+bool isOpen() const;
+
+void beginPlan(int width, int height, int startX, int startY, int goalX, int goalY);
+void cell(int index, unsigned char cost);
+
+/**
+ * [endPlan  writes the record of the plan and flushes it]
+ * @param  status     [PlanStatus of the replan, or PLAN_LOG_REUSED]
+ * @param  pathLength [cells of the planner path]
+ */
+void endPlan(int status, unsigned long pathLength);
+
+private:
+
+FILE *file_;
+PlanLogRecord record_;
+bool inPlan_;
+};
+
+/**
+ * [PlanLogReader  reads back a plan log]
+ */
+class PlanLogReader {
+
+public:
+
+PlanLogReader();
+~PlanLogReader();
+
+/**
+ * [open  reads the header and the configuration]
+ * @return [false if file is not a plan log of this version]
+ */
+bool open(const std::string &file, PlanLogConfig &config);
+void close();
+
+/**
+ * [rewind  back to the first record]
+ */
+void rewind();
+
+/**
+ * [next  reads the next record]
+ * @return [false at the end of the log or on a truncated record]
+ */
+bool next(PlanLogRecord &record);
+
+private:
+
+FILE *file_;
+long first_; // offset of the first record
+};
+
+#endif
@@ -0,0 +1,130 @@
+/**
+ * @Filename: plan_profiler.h
+ * Phase latencies of the planning cycle: rolling histograms and an
+ * optional Chrome trace-event dump.
+ * You may use, distribute and modify this code under the
+ * terms of the BSD license.
+ */
+#ifndef PLAN_PROFILER_H
+#define PLAN_PROFILER_H
+
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+/**
+ * [RollingHistogram  the last window samples of a latency, in seconds,
+ * from which percentiles are taken]
+ */
+class RollingHistogram {
+
+public:
+
+explicit RollingHistogram(size_t window = 100);
+
+void   add(double v);
+void   clear();
+
+/**
+ * [count  number of samples in the window]
+ */
+size_t count() const;
+
+/**
+ * [total  number of samples added since the last clear]
+ */
+unsigned long total() const;
+
+/**
+ * [percentile  nearest rank percentile of the window]
+ * @param  p [0..1]
+ * @return   [sample value, 0 for an empty window]
+ */
+double percentile(double p) const;
+
+double last() const;
+double max() const;
+double mean() const;
+
+private:
+
+std::vector<double> samples_;
+size_t window_;
+size_t next_;
+unsigned long total_;
+double last_;
+};
+
+/**
+ * [PlanProfiler  times the phases of a planning cycle with a monotonic
+ * clock. A cycle is opened by beginCycle, every phase(name) closes the
+ * running phase and opens the next one, endCycle closes both. Each phase
+ * and the whole cycle ("cycle") get a RollingHistogram, and every phase
+ * can be written to a Chrome trace-event file (chrome://tracing,
+ * Perfetto) as a complete event]
+ */
+class PlanProfiler {
+
+public:
+
+explicit PlanProfiler(size_t window = 100);
+~PlanProfiler();
+
+void   beginCycle();
+void   phase(const char *name);
+void   endCycle();
+
+/**
+ * [setWindow  number of cycles kept by the histograms, clears them]
+ */
+void   setWindow(size_t window);
+
+/**
+ * [openTrace  writes every following phase to file, in the JSON array
+ * trace-event format which stays readable if the process dies]
+ * @param  file [path of the trace file, truncated]
+ * @return      [false if the file cannot be opened]
+ */
+bool   openTrace(const std::string &file);
+void   closeTrace();
+
+/**
+ * [phases  number of histograms, the cycle being the first one, in
+ * the order the phases were first seen]
+ */
+size_t phases() const;
+const std::string &phaseName(size_t i) const;
+const RollingHistogram &histogram(size_t i) const;
+
+/**
+ * [Cycle  scope of a planning cycle, ends it on every return path]
+ */
+struct Cycle {
+        explicit Cycle(PlanProfiler &p) : profiler(p) { profiler.beginCycle(); }
+        ~Cycle() { profiler.endCycle(); }
+        PlanProfiler &profiler;
+};
+
+private:
+
+typedef std::chrono::steady_clock Clock;
+
+std::vector<std::string> names_;
+std::vector<RollingHistogram> histograms_;
+size_t window_;
+
+bool inCycle_;
+int current_; // running phase, -1 for none
+Clock::time_point cycleBegin_, phaseBegin_;
+
+FILE *trace_;
+bool traceEmpty_;
+Clock::time_point epoch_; // time 0 of the trace
+
+size_t indexOf(const char *name);
+void   closePhase(Clock::time_point now);
+void   record(size_t i, Clock::time_point begin, Clock::time_point end);
+};
+
+#endif
@@ -30,12 +30,20 @@
 #include <cstdlib>
 #include <fstream>
 #include <iostream>
+#include <unordered_set>
 
 #include <ros/ros.h>
 #include <ros/console.h>
+#include <ros/callback_queue.h>
 
 #include <tf/transform_listener.h>
 
+#include <boost/bind.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
+
 #include <visualization_msgs/Marker.h>
 #include <visualization_msgs/MarkerArray.h>
 
@@ -47,6 +55,10 @@
 #include <nav_msgs/OccupancyGrid.h>
 #include <nav_msgs/Odometry.h>
 
+#include <map_msgs/OccupancyGridUpdate.h>
+
+#include <diagnostic_msgs/DiagnosticArray.h>
+
 #include <geometry_msgs/Point.h>
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/Quaternion.h>
@@ -57,6 +69,11 @@
 #include <Dstar_lite_planning/world_model.h>
 #include <Dstar_lite_planning/costmap_model.h>
 #include <Dstar_lite_planning/Dstarlite.h>
+#include <Dstar_lite_planning/costmap_ingest.h>
+#include <Dstar_lite_planning/plan_profiler.h>
+#include <Dstar_lite_planning/plan_log.h>
+#include <Dstar_lite_planning/PlannerStats.h>
+#include <Dstar_lite_planning/CostField.h>
 #include <Dstar_lite_planning/pathSplineSmoother/pathSplineSmoother.h>
 
 #include <costmap_2d/costmap_2d_ros.h>
@@ -65,8 +82,6 @@
 
 #include <nav_core/base_global_planner.h>
 
-#define COST_POSSIBLY_CIRCUMSCRIBED 128
-
 
 
 
@@ -98,11 +113,20 @@ ros::Publisher pub_samples_;
 ros::Publisher pub_graph_;
 ros::Publisher pub_no_plan_;
 ros::Publisher pub_obstacle_markers_;
+ros::Publisher pub_stats_;
+ros::Publisher pub_diagnostics_;
+ros::Publisher pub_field_;
 
 
 ros::Subscriber sub_obstacles_;
+ros::Subscriber sub_obstacle_updates_;
 ros::Subscriber sub_all_agents_;
 
+// the costmap callbacks wait for the costmap and the planner, they are
+// served by their own thread instead of the spinner of move_base
+ros::CallbackQueue costmap_queue_;
+ros::AsyncSpinner *costmap_spinner_;
+
 
 
 public:
@@ -130,6 +154,11 @@ SrlDstarLite(std::string name, costmap_2d::Costmap2DROS* costmap_ros) : costmap_
         initialize(name, costmap_ros);
 }
 
+/**
+ * @brief Destructor, stops the planner thread
+ */
+~SrlDstarLite();
+
 /**
  * @brief Initialize the ros handle
  * @param name, Ros NodeHandle name
@@ -146,6 +175,43 @@ void initialize(std::string name, costmap_2d::Costmap2DROS* costmap_ros);
  */
 bool makePlan(const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal, std::vector<geometry_msgs::PoseStamped>& plan );
 
+/**
+ * @brief computePlan, the planning pipeline run by makePlan, or by the planner thread with ASYNC_ON
+ * @param start, Start pose
+ * @param goal, goal pose
+ * @param plan, generated path
+ * @param map_version, if not NULL, set to the map version the plan was made on, read under the planner lock
+ * @return bool, true if a path was found
+ */
+bool computePlan(const geometry_msgs::PoseStamped& start, const geometry_msgs::PoseStamped& goal, std::vector<geometry_msgs::PoseStamped>& plan,
+                 unsigned long *map_version = NULL );
+
+/**
+ * @brief asyncLoop, body of the planner thread, repairs the plan of the last request
+ * @return void
+ */
+void asyncLoop();
+
+/**
+ * @brief storeAsyncPlan, keep a plan as the freshest one, tagging its poses
+ * @param request, number of the makePlan request it answers
+ * @param goal, goal pose of the request
+ * @param plan, generated path, header.seq set to map_version and header.stamp to now
+ * @param found, true if a path was found
+ * @param map_version, map version the plan was made on, see computePlan
+ * @return void
+ */
+void storeAsyncPlan(unsigned long request, const geometry_msgs::PoseStamped& goal,
+                    std::vector<geometry_msgs::PoseStamped>& plan, bool found, unsigned long map_version);
+
+/**
+ * @brief trimPlan, cut a plan made from an older start at the robot: the poses before the first segment passing next to it are replaced by the robot pose
+ * @param plan, plan to cut, in the costmap frame
+ * @param start, robot pose, in the costmap frame
+ * @return bool, false if no segment of the plan passes next to the robot
+ */
+bool trimPlan(std::vector<geometry_msgs::PoseStamped>& plan, const geometry_msgs::PoseStamped& start);
+
 
 /**
  * @brief callbackObstacles, Read occupancy grid from global cost map
@@ -153,20 +219,86 @@ bool makePlan(const geometry_msgs::PoseStamped& start, const geometry_msgs::Pose
  */
 void callbackObstacles(const nav_msgs::OccupancyGrid::ConstPtr& msg);
 
+/**
+ * @brief callbackObstacleUpdates, Read the patch of the global cost map that changed
+ * @return void
+ */
+void callbackObstacleUpdates(const map_msgs::OccupancyGridUpdate::ConstPtr& msg);
+
+/**
+ * @brief ingestPatch, Send the costs of a rectangle of the costmap to the planner
+ * @param x, y, first cell of the rectangle
+ * @param width, height, size of the rectangle in cells
+ * @return void
+ */
+void ingestPatch(int x, int y, int width, int height);
+
+/**
+ * @brief markPatch, Add a rectangle of the costmap that changed to the cells the next ROI_RADIUS plan compares
+ * @param x, y, first cell of the rectangle
+ * @param width, height, size of the rectangle in cells
+ * @return void
+ */
+void markPatch(int x, int y, int width, int height);
+
 /**
  * @brief publishPath, Publish path
  * @return void
  */
 void publishPath(std::vector< geometry_msgs::PoseStamped > grid_plan);
 
+/**
+ * @brief publishStats, Publish the work of the planner in the last plan
+ * @param status, outcome of the search
+ * @param plan_time, seconds spent in plan up to the planner path
+ * @return void
+ */
+void publishStats(PlanStatus status, double plan_time);
+
+/**
+ * @brief publishDiagnostics, Publish the phase latencies of makePlan on /diagnostics
+ * @return void
+ */
+void publishDiagnostics();
+
+/**
+ * @brief publishCostField, Publish the cost to goal of the cells within FIELD_RADIUS of the start
+ * @param start_mx, start cell
+ * @param start_my, start cell
+ * @return void
+ */
+void publishCostField(int start_mx, int start_my);
+
 
 /**
  * @brief plan a kinodynamic path using RRT
  * @param, grid_plan Plan generated
  * @param, start pose
+ * @param, costmap_lock lock of the costmap held by the caller, let go once the costmap is ingested
  * @return true, if the plan was found
  */
-int plan(std::vector< geometry_msgs::PoseStamped > &grid_plan, geometry_msgs::PoseStamped& start);
+int plan(std::vector< geometry_msgs::PoseStamped > &grid_plan, geometry_msgs::PoseStamped& start,
+         boost::unique_lock<costmap_2d::Costmap2D::mutex_t> &costmap_lock);
+
+/**
+ * @brief reusePlan, return the last plan without its traversed part when no cost changed near the rest of it
+ * @param, grid_plan Plan returned
+ * @param, start pose
+ * @param, start_mx, start_my, start cell
+ * @param, goal_mx, goal_my, goal cell
+ * @return true, if the last plan was reused
+ */
+bool reusePlan(std::vector< geometry_msgs::PoseStamped > &grid_plan, geometry_msgs::PoseStamped& start,
+               int start_mx, int start_my, int goal_mx, int goal_my);
+
+/**
+ * @brief planCells, list the costmap cells crossed by a plan
+ * @param, grid_plan Plan
+ * @param, cells, cells in the order of the plan
+ * @param, poses, index in grid_plan of the pose ending the segment of each cell
+ * @return void
+ */
+void planCells(const std::vector< geometry_msgs::PoseStamped > &grid_plan, std::vector<Node> &cells, std::vector<size_t> &poses);
 
 /**
  * @brief set the Goal region
@@ -179,6 +311,14 @@ int plan(std::vector< geometry_msgs::PoseStamped > &grid_plan, geometry_msgs::Po
  */
 void setGoal(double x, double y, double theta, double toll, std::string goal_frame);
 
+/**
+ * @brief storeGoal, keep the goal region description, the goal being already in the costmap frame
+ * @param, goal goal pose in the costmap frame
+ * @param, toll tolerance of the goal
+ * @return void
+ */
+void storeGoal(const geometry_msgs::PoseStamped& goal, double toll);
+
 
 /**
  * @brief Transform pose in planner_frame
@@ -285,7 +425,7 @@ double center_map_y_;     ///<  @brief y coordinate of the center of 2D space wh
 
 int cnt_no_plan_;     ///<  @brief counter of no planning sol
 
-Dstar *dstar_planner_;     ///<  Dstar planner
+DstarBase *dstar_planner_;     ///<  Dstar planner
 
 PathSplineSmoother *spline_smoother_;
 
@@ -293,6 +433,116 @@ bool SMOOTHING_ON_;
 
 bool SHORTCUTTING_ON_;
 
+bool DENSE_GRID_ON_;     ///<  @brief Keep the D* Lite cells in flat arrays sized from the costmap
+
+bool TILED_GRID_ON_;     ///<  @brief Split the flat arrays in 64x64 tiles allocated when the planner first touches them
+
+int CONNECTIVITY_;     ///<  @brief Moves out of a cell: 4, 8 or 16
+
+std::string COST_TYPE_;     ///<  @brief Planner cost storage: double, uint32 or uint16
+
+bool ANYTIME_ON_;     ///<  @brief Plan with Anytime D*, improving an inflated solution while PLANNING_TIME allows
+
+double EPSILON_START_;     ///<  @brief Heuristic inflation of the first Anytime D* search
+
+double EPSILON_STEP_;     ///<  @brief Decrease of the inflation between Anytime D* searches
+
+double PLANNING_TIME_;     ///<  @brief Deadline of makePlan in seconds, <= 0 for none (plain D* Lite only), a longer search is resumed by the next makePlan
+
+double SCRATCH_FRACTION_;     ///<  @brief Share of changed cells (a new goal counts as all) above which a plain D* Lite makePlan uses A* from scratch, 0 for never
+
+double ROI_RADIUS_;     ///<  @brief Meters around the start scanned for cost changes after the first full load, with the costmap updates published since the last plan, 0 for the whole map
+
+bool roi_published_;     ///<  @brief The costmap publishes its updates, without them a ROI_RADIUS plan compares the whole map
+
+boost::mutex roi_mutex_;     ///<  @brief Guards the rectangle of the published updates
+
+int roi_x0_, roi_y0_, roi_x1_, roi_y1_;     ///<  @brief Cells [x0,x1) x [y0,y1) covering the costmap updates published since the last plan, empty if x1 <= x0
+
+double FIELD_RADIUS_;     ///<  @brief Meters around the start of the cost to goal field published after a plan, 0 for none
+
+std::vector<float> cost_field_;     ///<  @brief Buffer of the cost to goal field
+
+bool PLAN_REUSE_ON_;     ///<  @brief Return the last plan, trimmed, while no cost changed on or next to it
+
+bool reuse_valid_;     ///<  @brief The last plan can be reused
+
+std::vector<geometry_msgs::PoseStamped> reuse_plan_;     ///<  @brief Last plan returned
+
+std::vector<Node> reuse_path_;     ///<  @brief Costmap cells crossed by the last plan
+
+std::vector<size_t> reuse_pose_;     ///<  @brief Pose of reuse_plan_ ending the segment of each cell of reuse_path_
+
+int reuse_goal_mx_, reuse_goal_my_;     ///<  @brief Goal cell of the last plan
+
+unsigned long reuse_map_version_;     ///<  @brief Map version the last plan was made on
+
+int LETHAL_COST_;     ///<  @brief First costmap cost taken as occupied by the planner
+
+double COST_SCALE_;     ///<  @brief Planner cost of a costmap cost c: max(1, COST_SCALE*c^COST_EXPONENT)
+
+double COST_EXPONENT_;     ///<  @brief Exponent of the cost curve, see COST_SCALE
+
+int PROFILE_WINDOW_;     ///<  @brief Number of makePlan calls the latency percentiles are taken over
+
+std::string TRACE_FILE_;     ///<  @brief Chrome trace-event file the makePlan phases are written to, empty for none
+
+double DIAGNOSTICS_PERIOD_;     ///<  @brief Seconds between two latency reports on /diagnostics, < 0 for none
+
+PlanProfiler profiler_;     ///<  @brief Phase latencies of makePlan
+
+ros::WallTime last_diagnostics_;     ///<  @brief Time of the last latency report
+
+std::string RECORD_FILE_;     ///<  @brief Plan log the planner inputs are recorded to for dstar_replay, empty for none
+
+PlanRecorder recorder_;     ///<  @brief Writer of the plan log
+
+bool COSTMAP_EVENTS_ON_;     ///<  @brief Send the costmap changes to the planner from the costmap update topics instead of sweeping the costmap in makePlan
+
+bool costmap_events_;     ///<  @brief A costmap message was received, the planner follows the updates
+
+boost::mutex planner_mutex_;     ///<  @brief Guards the planner and the plan state between makePlan, the planner thread and the costmap callbacks
+
+unsigned long map_version_;     ///<  @brief Number of costmap changes sent to the planner
+
+bool ASYNC_ON_;     ///<  @brief Plan in a planner thread, makePlan returning its freshest plan
+
+double ASYNC_PERIOD_;     ///<  @brief Seconds between two repairs of the plan by the planner thread
+
+double MAX_PLAN_AGE_;     ///<  @brief Oldest plan makePlan returns with ASYNC_ON, beyond it makePlan plans itself
+
+boost::thread *async_thread_;     ///<  @brief Planner thread
+
+boost::mutex async_mutex_;     ///<  @brief Guards the request and the plan shared with the planner thread
+
+boost::condition_variable async_cond_;     ///<  @brief Wakes the planner thread on a request or on exit
+
+bool async_stop_;     ///<  @brief The planner thread has to exit
+
+geometry_msgs::PoseStamped async_start_, async_goal_;     ///<  @brief Poses of the last makePlan request
+
+unsigned long async_request_;     ///<  @brief Number of the last makePlan request
+
+ros::WallTime async_last_request_;     ///<  @brief Time of the last makePlan request
+
+std::vector<geometry_msgs::PoseStamped> async_plan_;     ///<  @brief Freshest plan
+
+bool async_found_;     ///<  @brief The freshest plan is a path
+
+ros::WallTime async_stamp_;     ///<  @brief Time the freshest plan was made
+
+unsigned long async_map_version_;     ///<  @brief Map version of the freshest plan
+
+unsigned long async_served_;     ///<  @brief Request the freshest plan answers, 0 for none
+
+geometry_msgs::PoseStamped async_served_goal_;     ///<  @brief Goal of the freshest plan
+
+CostmapIngest costmap_ingest_;     ///<  @brief Shadow copy of the char map last sent to the planner
+
+int last_start_mx_, last_start_my_;     ///<  @brief Start cell of the last plan
+
+int last_goal_mx_, last_goal_my_;     ///<  @brief Goal cell of the last plan
+
 };
 
 }
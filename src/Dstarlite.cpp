@@ -13,84 +13,550 @@
 #include "Dstar_lite_planning/Dstarlite.h"
 #include <stdio.h>
 #include <cmath>
+#include <algorithm>
+
+// NodeInfo flags
+#define CELL_CREATED 0x01 // the cell has its own NodeInfo (makeNewCell)
+#define CELL_CLOSED  0x02 // expanded as overconsistent in this AD* search
+#define CELL_INCONS  0x04 // inconsistent and waiting in inconsList
+
+// side of the tiles of the tiled storage, 1 << TILE_SHIFT cells
+#define TILE_SHIFT 6
+#define TILE_SIZE  (1 << TILE_SHIFT)
+#define TILE_MASK  (TILE_SIZE - 1)
+
+// steps of the greedy walk looking for their cell on the previous path
+#define PATH_REJOIN_STEPS 16
+
+constexpr int FourConnected::DX[];
+constexpr int FourConnected::DY[];
+constexpr double FourConnected::LENGTH[];
+constexpr unsigned int FourConnected::BLOCK[];
+
+constexpr int EightConnected::DX[];
+constexpr int EightConnected::DY[];
+constexpr double EightConnected::LENGTH[];
+constexpr unsigned int EightConnected::BLOCK[];
+
+constexpr int SixteenConnected::DX[];
+constexpr int SixteenConnected::DY[];
+constexpr double SixteenConnected::LENGTH[];
+constexpr unsigned int SixteenConnected::BLOCK[];
+
+template <class K>
+bool OpenList<K>::empty() const {
+        return heap.empty();
+}
+
+template <class K>
+size_t OpenList<K>::size() const {
+        return heap.size();
+}
+
+/* const Node &OpenList::top() const
+ * --------------------------
+ * Returns the Node with the smallest key.
+ */
+template <class K>
+const Node &OpenList<K>::top() const {
+        return heap.front().u;
+}
+
+/* const K &OpenList::topKey() const
+ * --------------------------
+ * Returns the smallest key.
+ */
+template <class K>
+const K &OpenList<K>::topKey() const {
+        return heap.front().k;
+}
+
+/* const Node &OpenList::nodeAt(size_t i) const
+ * --------------------------
+ * Returns the Node at heap position i, to walk over the whole list.
+ */
+template <class K>
+const Node &OpenList<K>::nodeAt(size_t i) const {
+        return heap[i].u;
+}
+
+/* void OpenList::setKeyAt(size_t i, const K &k)
+ * --------------------------
+ * Changes the key at heap position i without restoring the heap
+ * order, heapify() has to be called once all keys are set.
+ */
+template <class K>
+void OpenList<K>::setKeyAt(size_t i, const K &k) {
+        heap[i].k = k;
+}
+
+/* void OpenList::heapify()
+ * --------------------------
+ * Restores the heap order after setKeyAt, in O(n).
+ */
+template <class K>
+void OpenList<K>::heapify() {
+
+        for (size_t i = heap.size()/2; i-- > 0; ) siftDown(i);
+}
+
+/* void OpenList::place(size_t i, const Entry &e)
+ * --------------------------
+ * Stores e at heap position i and records the position in its cell.
+ */
+template <class K>
+void OpenList<K>::place(size_t i, const Entry &e) {
+
+        heap[i] = e;
+        *e.heapIndex = (int)i;
+}
+
+template <class K>
+void OpenList<K>::siftUp(size_t i) {
+
+        Entry e = heap[i];
+        while (i > 0) {
+                size_t parent = (i-1)/2;
+                if (!(e.k < heap[parent].k)) break;
+                place(i, heap[parent]);
+                i = parent;
+        }
+        place(i, e);
+}
+
+template <class K>
+void OpenList<K>::siftDown(size_t i) {
+
+        Entry e = heap[i];
+        size_t n = heap.size();
+        while (true) {
+                size_t child = 2*i+1;
+                if (child >= n) break;
+                if ((child+1 < n) && (heap[child+1].k < heap[child].k)) child++;
+                if (!(heap[child].k < e.k)) break;
+                place(i, heap[child]);
+                i = child;
+        }
+        place(i, e);
+}
+
+/* void OpenList::push(const Node &u, const K &k, int *heapIndex)
+ * --------------------------
+ * Inserts Node u with the key k, heapIndex is the position field of its
+ * cell.
+ */
+template <class K>
+void OpenList<K>::push(const Node &u, const K &k, int *heapIndex) {
+
+        Entry e;
+        e.u = u;
+        e.k = k;
+        e.heapIndex = heapIndex;
+        heap.push_back(e);
+        siftUp(heap.size()-1);
+}
+
+/* void OpenList::update(const Node &u, const K &k, int *heapIndex)
+ * --------------------------
+ * Changes the key of Node u to k, inserting it if it is not on the
+ * list yet.
+ */
+template <class K>
+void OpenList<K>::update(const Node &u, const K &k, int *heapIndex) {
+
+        if (*heapIndex < 0) {
+                push(u, k, heapIndex);
+                return;
+        }
+
+        size_t i = *heapIndex;
+        bool decreased = k < heap[i].k;
+        heap[i].k = k;
+        if (decreased) siftUp(i);
+        else siftDown(i);
+}
+
+/* void OpenList::remove(int *heapIndex)
+ * --------------------------
+ * Removes the Node whose position field is heapIndex, if it is on the
+ * list.
+ */
+template <class K>
+void OpenList<K>::remove(int *heapIndex) {
+
+        if (*heapIndex < 0) return;
+
+        size_t i = *heapIndex;
+        *heapIndex = -1;
+
+        Entry last = heap.back();
+        heap.pop_back();
+        if (i == heap.size()) return;
+
+        bool decreased = last.k < heap[i].k;
+        place(i, last);
+        if (decreased) siftUp(i);
+        else siftDown(i);
+}
+
+/* void OpenList::clear()
+ * --------------------------
+ * Empties the list. The heap positions stored in the cells are not
+ * reset, the cells are expected to be dropped as well.
+ */
+template <class K>
+void OpenList<K>::clear() {
+        heap.clear();
+}
 
 /**
  * [class constructor]
  */
-Dstar::Dstar(int startX, int startY, int goalX, int goalY) {
-        init(startX,startY,goalX,goalY);
+template <class Connectivity, class CostT>
+DstarT<Connectivity, CostT>::DstarT(int startX, int startY, int goalX, int goalY) {
         maxSteps = 80000; // node expansions before we give up
-        D       = 1; // cost of an unseen cell
+        D       = Traits::fromDouble(1); // cost of an unseen cell
+        for (int i = 0; i < Connectivity::N; i++)
+                len[i] = Traits::moveLength(Connectivity::LENGTH[i]);
+        eps = epsStart = keyEps = pathEps = 1; // plain D* Lite
+        epsStep = 0;
+        costsChanged = false;
+        searchSuspended = false;
+        cellCount = 0;
+        scratchFraction = 0;
+        changedCells = 0;
+        goalMoved = false;
+        scratchStamp = 0;
+        gridWidth = gridHeight = 0; // hash storage
+        tiled = false;
+        tileCols = 0;
+        tileCount = 0;
+        init(startX,startY,goalX,goalY);
 }
 /**
  * [class constructor]
  */
-Dstar::Dstar() {
+template <class Connectivity, class CostT>
+DstarT<Connectivity, CostT>::DstarT() {
 
         maxSteps = 80000; // node expansions before we give up
-        D       = 1; // cost of an unseen cell
+        D       = Traits::fromDouble(1); // cost of an unseen cell
+        for (int i = 0; i < Connectivity::N; i++)
+                len[i] = Traits::moveLength(Connectivity::LENGTH[i]);
+        eps = epsStart = keyEps = pathEps = 1; // plain D* Lite
+        epsStep = 0;
+        costsChanged = false;
+        searchSuspended = false;
+        cellCount = 0;
+        scratchFraction = 0;
+        changedCells = 0;
+        goalMoved = false;
+        scratchStamp = 0;
+        gridWidth = gridHeight = 0; // hash storage
+        tiled = false;
+        tileCols = 0;
+        tileCount = 0;
 
 }
 
+/* void Dstar::setGridSize(int width, int height)
+ * --------------------------
+ * Switches the cell storage to flat arrays covering the bounded grid
+ * [0,width) x [0,height), indexed by y*width+x, or to tiles of it (see
+ * setTiled). Cells outside of the grid are treated as occupied. A size
+ * of 0 switches back to the hash_map storage. All cells are dropped, so
+ * init() has to be called afterwards, with a start and goal lying on the
+ * grid.
+ */
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::setGridSize(int width, int height) {
+
+        if (width <= 0 || height <= 0) width = height = 0;
+
+        gridWidth  = width;
+        gridHeight = height;
+        grid.clear();
+        grid.shrink_to_fit();
+        tiles.clear();
+        tiles.shrink_to_fit();
+        tileCols = 0;
+        if ((gridWidth > 0) && tiled) {
+                tileCols = (gridWidth + TILE_MASK) >> TILE_SHIFT;
+                tiles.resize((size_t)tileCols*((gridHeight + TILE_MASK) >> TILE_SHIFT));
+        } else if (gridWidth > 0) grid.resize((size_t)gridWidth*gridHeight);
+
+        clearCells();
+        path.clear();
+        lastPath.clear();
+}
 
-/**
- * [Dstar::keyHashCode Returns the key hash code for the Node u, this is used
- * to compare, Node that have been updated, based on the x and y value]
- * @param  u [Node]
- * @return   [float]
+/* void Dstar::setTiled(bool tiled)
+ * --------------------------
+ * Splits the flat arrays of the next setGridSize into tiles of TILE_SIZE
+ * x TILE_SIZE cells, allocated when the search or a cost update creates
+ * one of their cells and freed when the cells are dropped (init, a moved
+ * goal). The memory then follows the part of the map the planner
+ * touched, for maps too large for the flat arrays, and the cells of a
+ * tile stay next to each other.
  */
-float Dstar::keyHashCode(Node u) {
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::setTiled(bool tiled) {
+        this->tiled = tiled;
+}
 
-        return (float)(u.k.first + 1193*u.k.second);
+/* int Dstar::getGridWidth()
+ * --------------------------
+ * Returns the width of the flat-array storage, 0 for hash storage.
+ */
+template <class Connectivity, class CostT>
+int DstarT<Connectivity, CostT>::getGridWidth() {
+        return gridWidth;
+}
 
+/* int Dstar::getGridHeight()
+ * --------------------------
+ * Returns the height of the flat-array storage, 0 for hash storage.
+ */
+template <class Connectivity, class CostT>
+int DstarT<Connectivity, CostT>::getGridHeight() {
+        return gridHeight;
 }
 
-/**
- * [Dstar::isValid Returns true if Node u is on the open list by checking if
- * it is in the hash table]
- * @param  u [Node]
- * @return   [boolean]
+/* bool Dstar::inGrid(const Node &u)
+ * --------------------------
+ * Returns true if Node u lies inside the flat-array storage.
  */
-bool Dstar::isValid(Node u) {
+template <class Connectivity, class CostT>
+bool DstarT<Connectivity, CostT>::inGrid(const Node &u) {
+        return (u.x >= 0) && (u.y >= 0) && (u.x < gridWidth) && (u.y < gridHeight);
+}
 
-        ds_oh::iterator cur = openHash.find(u);
-        if (cur == openHash.end()) return false;
-        if (!AreSame(keyHashCode(u), cur->second)) return false;
-        return true;
+/* void Dstar::clampToGrid(Node &u)
+ * --------------------------
+ * Moves Node u to the nearest cell of the flat-array storage, for a start
+ * or goal given off the grid, which has no cell to hold it. Nothing to do
+ * with hash storage, where every cell exists.
+ */
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::clampToGrid(Node &u) {
 
+        if ((gridWidth == 0) || inGrid(u)) return;
+        fprintf(stderr, "Cell %d %d is off the grid, moved onto it\n", u.x, u.y);
+        u.x = std::max(0, std::min(u.x, gridWidth - 1));
+        u.y = std::max(0, std::min(u.y, gridHeight - 1));
 }
 
+/* NodeInfo *Dstar::denseCell(const Node &u)
+ * --------------------------
+ * Returns the flat-array or tile cell of Node u, NULL if u is outside
+ * the grid or its tile is not allocated.
+ */
+template <class Connectivity, class CostT>
+typename DstarT<Connectivity, CostT>::NodeInfo *DstarT<Connectivity, CostT>::denseCell(const Node &u) {
+
+        if (!inGrid(u)) return NULL;
+        if (tileCols == 0) return &grid[(size_t)u.y*gridWidth + u.x];
+
+        vector<NodeInfo> &tile = tiles[(size_t)(u.y >> TILE_SHIFT)*tileCols + (u.x >> TILE_SHIFT)];
+        if (tile.empty()) return NULL;
+        return &tile[((u.y & TILE_MASK) << TILE_SHIFT) + (u.x & TILE_MASK)];
+}
+
+/* NodeInfo *Dstar::newTile(const Node &u)
+ * --------------------------
+ * Allocates the tile of Node u, without any cell created, and returns
+ * the cell of u.
+ */
+template <class Connectivity, class CostT>
+typename DstarT<Connectivity, CostT>::NodeInfo *DstarT<Connectivity, CostT>::newTile(const Node &u) {
+
+        NodeInfo empty;
+        empty.flags = 0;
+        tiles[(size_t)(u.y >> TILE_SHIFT)*tileCols + (u.x >> TILE_SHIFT)].assign(TILE_SIZE*TILE_SIZE, empty);
+        tileCount++;
+        return denseCell(u);
+}
+
+/* NodeInfo *Dstar::findCell(const Node &u)
+ * --------------------------
+ * Returns the NodeInfo of Node u, NULL if the cell was never created.
+ */
+template <class Connectivity, class CostT>
+typename DstarT<Connectivity, CostT>::NodeInfo *DstarT<Connectivity, CostT>::findCell(const Node &u) {
+
+        if (gridWidth > 0) {
+                NodeInfo *c = denseCell(u);
+                if (c == NULL || !(c->flags & CELL_CREATED)) return NULL;
+                return c;
+        }
+
+        typename ds_ch::iterator cur = cellHash.find(u);
+        if (cur == cellHash.end()) return NULL;
+        return &cur->second;
+}
+
+/* NodeInfo &Dstar::cellInfo(const Node &u)
+ * --------------------------
+ * Returns the NodeInfo of Node u, creating the cell if needed.
+ */
+template <class Connectivity, class CostT>
+typename DstarT<Connectivity, CostT>::NodeInfo &DstarT<Connectivity, CostT>::cellInfo(const Node &u) {
+
+        makeNewCell(u);
+        if (gridWidth > 0) return *denseCell(u);
+        return cellHash[u];
+}
+
+/* void Dstar::clearCells()
+ * --------------------------
+ * Drops every cell and empties the open list.
+ */
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::clearCells() {
+
+        openList.clear();
+        closedList.clear();
+        inconsList.clear();
+        searchSuspended = false;
+        cellCount = 0;
+        cellHash.clear();
+        if (tileCols > 0) {
+                for (size_t i = 0; i < tiles.size(); i++) vector<NodeInfo>().swap(tiles[i]);
+                tileCount = 0;
+        } else if (gridWidth > 0) {
+                NodeInfo empty;
+                empty.flags = 0;
+                grid.assign(grid.size(), empty);
+        }
+}
+
+
 /* void Dstar::getPath()
  * --------------------------
  * Returns the path created by replan()
  */
-list<Node> Dstar::getPath() {
+template <class Connectivity, class CostT>
+list<Node> DstarT<Connectivity, CostT>::getPath() {
+        return list<Node>(path.begin(), path.end());
+}
+
+/* const vector<Node> &Dstar::pathCells()
+ * --------------------------
+ * The path created by replan() without a copy. It stays valid until the
+ * next replan.
+ */
+template <class Connectivity, class CostT>
+const vector<Node> &DstarT<Connectivity, CostT>::pathCells() {
         return path;
 }
 
+/* double Dstar::costToGoal(Node u, const NodeKey *top)
+ * --------------------------
+ * The cost to goal of Node u as settled by the searches so far, in
+ * lengths of free cells: its g value, if u is consistent and its key is
+ * not above top, the smallest key on the openList (NULL if the openList
+ * is empty). The g values of such Nodes are exact, or at most getEpsilon()
+ * times too high after a search of Anytime D*, and the greedy descent
+ * from them reaches the goal. INFINITY for an occupied Node or a Node
+ * with no path to the goal, NAN for a Node the searches left unsettled.
+ */
+template <class Connectivity, class CostT>
+double DstarT<Connectivity, CostT>::costToGoal(Node u, const NodeKey *top) {
+
+        if (occupied(u)) return INFINITY;
+
+        Dist g = getG(u);
+        if (!AreSame(g, getRHS(u))) return NAN;
+        if ((top != NULL) && (*top < calculateKey(u))) return NAN;
+        return Traits::toLength(g);
+}
+
+/* double Dstar::getCostToGoal(int x, int y)
+ * --------------------------
+ * The cost to goal of cell (x,y), see costToGoal.
+ */
+template <class Connectivity, class CostT>
+double DstarT<Connectivity, CostT>::getCostToGoal(int x, int y) {
+
+        Node u;
+        u.x = x;
+        u.y = y;
+        return costToGoal(u, openList.empty() ? NULL : &openList.topKey());
+}
+
+/* void Dstar::getCostField(int x0, int y0, int width, int height, vector<float> &field)
+ * --------------------------
+ * The cost to goal (see costToGoal) of the cells of the window of the
+ * given size whose lower left cell is (x0,y0), row by row: cell (x,y) at
+ * (y-y0)*width + x-x0. A navigation function for a local planner, which
+ * only has to descend it from any of its cells.
+ */
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::getCostField(int x0, int y0, int width, int height, vector<float> &field) {
+
+        if (width < 0) width = 0;
+        if (height < 0) height = 0;
+        field.resize((size_t)width*height);
+
+        const NodeKey *top = openList.empty() ? NULL : &openList.topKey();
+        Node u;
+        size_t i = 0;
+        for (u.y = y0; u.y < y0 + height; u.y++) {
+                for (u.x = x0; u.x < x0 + width; u.x++) {
+                        field[i++] = (float)costToGoal(u, top);
+                }
+        }
+}
+
 /* bool Dstar::occupied(Node u)
  * --------------------------
  * returns true if the cell is occupied (non-traversable), false
  * otherwise. non-traversable are marked with a cost < 0.
  */
-bool Dstar::occupied(Node u) {
+template <class Connectivity, class CostT>
+bool DstarT<Connectivity, CostT>::occupied(Node u) {
+
+        if ((gridWidth > 0) && !inGrid(u)) return true;
 
-        ds_ch::iterator cur = cellHash.find(u);
-        if (cur == cellHash.end()) return false;
-        return (cur->second.cost < 0);
+        NodeInfo *cur = findCell(u);
+        if (cur == NULL) return false;
+        return Traits::isOccupied(cur->cost);
+}
+
+/* bool Dstar::blocked(Node u, int move)
+ * --------------------------
+ * Returns true if the given move out of Node u is not one of its
+ * successors: Node u is occupied, or so is the neighbour reached or a
+ * cell whose corner the move cuts (see getPred).
+ */
+template <class Connectivity, class CostT>
+bool DstarT<Connectivity, CostT>::blocked(Node u, int move) {
+
+        if (occupied(u)) return true;
+
+        unsigned int block = Connectivity::BLOCK[move];
+        for (int i = 0; i < Connectivity::N; i++) {
+                if ((block & (1u << i)) == 0) continue;
+                Node v;
+                v.x = u.x + Connectivity::DX[i];
+                v.y = u.y + Connectivity::DY[i];
+                if (occupied(v)) return true;
+        }
+        return false;
 }
 
 /* void Dstar::init(int sX, int sY, int gX, int gY)
  * --------------------------
  * Init dstar with start and goal coordinates, rest is as per
- * [S. Koenig, 2002]
+ * [S. Koenig, 2002]. With flat-array storage both are moved onto the grid
+ * (see clampToGrid).
  */
-void Dstar::init(int sX, int sY, int gX, int gY) {
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::init(int sX, int sY, int gX, int gY) {
 
-        cellHash.clear();
+        clearCells();
         path.clear();
-        openHash.clear();
-        while(!openList.empty()) openList.pop();
+        lastPath.clear();
 
         k_m = 0;
 
@@ -98,18 +564,20 @@ void Dstar::init(int sX, int sY, int gX, int gY) {
         s_start.y = sY;
         s_goal.x  = gX;
         s_goal.y  = gY;
+        clampToGrid(s_start);
+        clampToGrid(s_goal);
 
         NodeInfo tmp;
         tmp.g = tmp.rhs =  0;
         tmp.cost = D;
+        tmp.heapIndex = -1;
+        tmp.flags = CELL_CREATED;
 
-        cellHash[s_goal] = tmp;
+        cellInfo(s_goal) = tmp;
 
         tmp.g = tmp.rhs = heuristic(s_start,s_goal);
         tmp.cost = D;
-        cellHash[s_start] = tmp;
-        s_start = calculateKey(s_start);
-        openList.push(s_start);
+        cellInfo(s_start) = tmp;
         s_last = s_start;
 
 }
@@ -119,220 +587,279 @@ void Dstar::init(int sX, int sY, int gX, int gY) {
  * --------------------------
  * Checks if a cell is in the hash table, if not it adds it in.
  */
-void Dstar::makeNewCell(Node u) {
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::makeNewCell(Node u) {
+
+        NodeInfo tmp;
+
+        if (gridWidth > 0) {
+                NodeInfo *c = denseCell(u);
+                if (c == NULL) {
+                        // off the grid, or in a tile not allocated yet
+                        if ((tileCols == 0) || !inGrid(u)) return;
+                        c = newTile(u);
+                }
+                else if (c->flags & CELL_CREATED) return;
+                c->g         = c->rhs = heuristic(u,s_goal);
+                c->cost      = D;
+                c->heapIndex = -1;
+                c->flags     = CELL_CREATED;
+                cellCount++;
+                stats.cellsCreated++;
+                return;
+        }
 
         if (cellHash.find(u) != cellHash.end()) return;
 
-        NodeInfo tmp;
         tmp.g       = tmp.rhs = heuristic(u,s_goal);
         tmp.cost    = D;
+        tmp.heapIndex = -1;
+        tmp.flags   = CELL_CREATED;
         cellHash[u] = tmp;
+        cellCount++;
+        stats.cellsCreated++;
 
 }
 
-/* double Dstar::getG(Node u)
+/* Dist Dstar::getG(Node u)
  * --------------------------
  * Returns the G value for Node u.
  */
-double Dstar::getG(Node u) {
+template <class Connectivity, class CostT>
+typename DstarT<Connectivity, CostT>::Dist DstarT<Connectivity, CostT>::getG(Node u) {
+
+        if ((gridWidth > 0) && !inGrid(u)) return Traits::INF();
 
-        if (cellHash.find(u) == cellHash.end())
+        NodeInfo *cur = findCell(u);
+        if (cur == NULL)
                 return heuristic(u,s_goal);
-        return cellHash[u].g;
+        return cur->g;
 
 }
 
-/* double Dstar::getRHS(Node u)
+/* Dist Dstar::getRHS(Node u)
  * --------------------------
  * Returns the rhs value for Node u.
  */
-double Dstar::getRHS(Node u) {
+template <class Connectivity, class CostT>
+typename DstarT<Connectivity, CostT>::Dist DstarT<Connectivity, CostT>::getRHS(Node u) {
 
         if (u == s_goal) return 0;
 
-        if (cellHash.find(u) == cellHash.end())
+        if ((gridWidth > 0) && !inGrid(u)) return Traits::INF();
+
+        NodeInfo *cur = findCell(u);
+        if (cur == NULL)
                 return heuristic(u,s_goal);
-        return cellHash[u].rhs;
+        return cur->rhs;
 
 }
 
-/* void Dstar::setG(Node u, double g)
+/* void Dstar::setG(Node u, Dist g)
  * --------------------------
  * Sets the G value for Node u
  */
-void Dstar::setG(Node u, double g) {
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::setG(Node u, Dist g) {
 
-        makeNewCell(u);
-        cellHash[u].g = g;
+        cellInfo(u).g = g;
 }
 
-/* void Dstar::setRHS(Node u, double rhs)
+/* void Dstar::setRHS(Node u, Dist rhs)
  * --------------------------
  * Sets the rhs value for Node u
  */
-double Dstar::setRHS(Node u, double rhs) {
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::setRHS(Node u, Dist rhs) {
 
-        makeNewCell(u);
-        cellHash[u].rhs = rhs;
+        cellInfo(u).rhs = rhs;
 
 }
 
-/* double Dstar::eightCondist(Node a, Node b)
+/* int Dstar::computeShortestPath(Clock::time_point deadline)
  * --------------------------
- * Returns the 8-way distance between Node a and Node b.
+ * As per [S. Koenig, 2002] except for 3 main modifications:
+ * 1. Without a deadline, we stop planning after a number of steps,
+ *    'maxsteps' we do this because this algorithm can plan forever if
+ *    the start is surrounded by obstacles.
+ * 2. With a deadline, the clock is read every 64 expansions and the
+ *    search stops once the deadline has passed, so that every call
+ *    makes some progress even with a deadline already passed.
+ * 3. Cells that were never touched are not on the open list, they
+ *    are assumed to be free with g = rhs = heuristic (see makeNewCell).
+ * Returns 0 once s_start is consistent, -1 after maxsteps expansions and
+ * 1 at the deadline. The openList is left as is in both latter cases, so
+ * that calling it again carries on with the same search.
  */
-double Dstar::eightCondist(Node a, Node b) {
-        double temp;
-        double min = abs(a.x - b.x);
-        double max = abs(a.y - b.y);
-        if (min > max) {
-                double temp = min;
-                min = max;
-                max = temp;
-        }
-        return ((M_SQRT2-1.0)*min + max);
-}
+template <class Connectivity, class CostT>
+int DstarT<Connectivity, CostT>::computeShortestPath(Clock::time_point deadline) {
 
-/* int Dstar::computeShortestPath()
- * --------------------------
- * As per [S. Koenig, 2002] except for 2 main modifications:
- * 1. We stop planning after a number of steps, 'maxsteps' we do this
- *    because this algorithm can plan forever if the start is
- *    surrounded by obstacles.
- * 2. We lazily remove Nodes from the open list so we never have to
- *    iterate through it.
- */
-int Dstar::computeShortestPath() {
-
-        list<Node> s;
-        list<Node>::iterator i;
-
-        if (openList.empty()) {
-                printf("openlist is empyt\n");
-                return -1;
-        }
+        Neighbours s;
 
+        bool bounded = (deadline != Clock::time_point::max());
         int k=0;
-        while ((!openList.empty()) ||
-               (openList.top() < (s_start = calculateKey(s_start))) ||
-               (getRHS(s_start) != getG(s_start))) {
+        NodeKey k_start = calculateKey(s_start);
+        while (!openList.empty() &&
+               ((openList.topKey() < k_start) || !AreSame(getRHS(s_start), getG(s_start)))) {
 
-                if (k++ > maxSteps) {
+                if (bounded) {
+                        if (((++k & 63) == 0) && (Clock::now() >= deadline)) return 1;
+                } else if (k++ > maxSteps) {
                         fprintf(stderr, "At maxsteps\n");
                         return -1;
                 }
 
+                Node u = openList.top();
+                NodeKey k_old = openList.topKey();
+                NodeKey k_new = calculateKey(u);
 
-                Node u;
-
-                bool test = (getRHS(s_start) != getG(s_start));
-
-                // lazy remove
-                while(1) {
-                        if (openList.empty()) return 1;
-                        u = openList.top();
-                        openList.pop();
-
-                        if (!isValid(u)) continue;
-                        if (!(u < s_start) && (!test)) return 2;
-                        break;
-                }
-
-                ds_oh::iterator cur = openHash.find(u);
-                openHash.erase(cur);
-
-                Node k_old = u;
-
-                if (k_old < calculateKey(u)) { // u is out of date
+                if (k_old < k_new) { // u is out of date
+                        stats.staleKeys++;
                         insert(u);
                 } else if (getG(u) > getRHS(u)) { // needs update (got better)
+                        stats.expansions++;
                         setG(u,getRHS(u));
+                        remove(u);
+                        if (eps > 1) {
+                                cellInfo(u).flags |= CELL_CLOSED;
+                                closedList.push_back(u);
+                        }
                         getPred(u,s);
-                        for (i=s.begin(); i != s.end(); i++) {
-                                updateVertex(*i);
+                        for (int i=0; i < s.size; i++) {
+                                updateVertex(s.n[i]);
                         }
                 } else { // g <= rhs, Node has got worse
-                        setG(u,INFINITY);
+                        stats.expansions++;
+                        // reopened, it may be expanded again as overconsistent
+                        setG(u,Traits::INF());
+                        cellInfo(u).flags &= ~CELL_CLOSED;
                         getPred(u,s);
-                        for (i=s.begin(); i != s.end(); i++) {
-                                updateVertex(*i);
+                        for (int i=0; i < s.size; i++) {
+                                updateVertex(s.n[i]);
                         }
                         updateVertex(u);
                 }
+
+                k_start = calculateKey(s_start);
         }
         return 0;
 }
 
 /**
- * [Dstar::AreSame determine two numbers are approximately same]
- * @param  x [double]
- * @param  y [double]
+ * [Dstar::AreSame determine two distances are the same, up to a tolerance
+ * for double costs]
+ * @param  x [Dist]
+ * @param  y [Dist]
  * @return   [bool]
  */
-bool Dstar::AreSame(double x, double y) {
+template <class Connectivity, class CostT>
+bool DstarT<Connectivity, CostT>::AreSame(Dist x, Dist y) {
 
-        if (std::isinf(x) && std::isinf(y)) return true;
-        return (fabs(x-y) < 0.00001);
+        return Traits::same(x, y);
 
 }
 
+
 /* void Dstar::updateVertex(Node u)
  * --------------------------
  * As per [S. Koenig, 2002]
  */
-void Dstar::updateVertex(Node u) {
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::updateVertex(Node u) {
+
+        Neighbours s;
 
-        list<Node> s;
-        list<Node>::iterator i;
+        stats.vertexUpdates++;
 
         if (u != s_goal) {
                 getSucc(u,s);
-                double tmp = INFINITY;
-                double tmp2;
+                Dist tmp = Traits::INF();
+                Dist tmp2;
 
-                for (i=s.begin(); i != s.end(); i++) {
-                        tmp2 = getG(*i) + cost(u,*i);
+                for (int i=0; i < s.size; i++) {
+                        tmp2 = Traits::add(getG(s.n[i]), cost(u,s.move[i]));
                         if (tmp2 < tmp) tmp = tmp2;
                 }
                 if (!AreSame(getRHS(u),tmp)) setRHS(u,tmp);
         }
 
-        if (!AreSame(getG(u),getRHS(u))) insert(u);
+        if (AreSame(getG(u),getRHS(u))) {
+                remove(u);
+                return;
+        }
+
+        // only overconsistent cells wait for the next search, an
+        // underconsistent cell has a g too low to build a path on
+        NodeInfo &info = cellInfo(u);
+        if (!(info.flags & CELL_CLOSED) || getG(u) < getRHS(u)) {
+                insert(u);
+        } else if (!(info.flags & CELL_INCONS)) {
+                info.flags |= CELL_INCONS;
+                inconsList.push_back(u);
+        }
 
 }
 
 /* void Dstar::insert(Node u)
  * --------------------------
- * Inserts Node u into openList and openHash.
+ * Inserts Node u into the openList with its current key, or updates
+ * its key if it is already on the list.
  */
-void Dstar::insert(Node u) {
-
-        ds_oh::iterator cur;
-        float csum;
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::insert(Node u) {
+
+        NodeKey k = calculateKey(u);
+        int *heapIndex = &cellInfo(u).heapIndex;
+        if (*heapIndex < 0) stats.heapPushes++;
+        else stats.heapUpdates++;
+        openList.update(u, k, heapIndex);
+        if (openList.size() > stats.peakOpenList) stats.peakOpenList = openList.size();
+}
 
-        u    = calculateKey(u);
-        cur  = openHash.find(u);
-        csum = keyHashCode(u);
-        // return if cell is already in list. TODO: this should be
-        // uncommented except it introduces a bug, I suspect that there is a
-        // bug somewhere else and having duplicates in the openList queue
-        // hides the problem...
-        //if ((cur != openHash.end()) && (AreSame(csum,cur->second))) return;
+/* void Dstar::remove(Node u)
+ * --------------------------
+ * Removes Node u from the openList, if it is on it.
+ */
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::remove(Node u) {
 
-        openHash[u] = csum;
-        openList.push(u);
+        NodeInfo *cur = findCell(u);
+        if ((cur == NULL) || (cur->heapIndex < 0)) return;
+        stats.heapRemoves++;
+        openList.remove(&cur->heapIndex);
 }
 
-/* void Dstar::remove(Node u)
+/* void Dstar::beginSearch()
  * --------------------------
- * Removes Node u from openHash. The Node is removed from the
- * openList lazilily (in replan) to save computation.
+ * Starts an AD* search with the current eps: the Nodes of INCONS go back
+ * on the openList, CLOSED is emptied and, if eps changed, every key on
+ * the openList is recomputed.
  */
-void Dstar::remove(Node u) {
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::beginSearch() {
 
-        ds_oh::iterator cur = openHash.find(u);
-        if (cur == openHash.end()) return;
-        openHash.erase(cur);
+        for (size_t i = 0; i < closedList.size(); i++) {
+                NodeInfo *cur = findCell(closedList[i]);
+                if (cur != NULL) cur->flags &= ~CELL_CLOSED;
+        }
+        closedList.clear();
+
+        for (size_t i = 0; i < inconsList.size(); i++) {
+                Node u = inconsList[i];
+                NodeInfo *cur = findCell(u);
+                if (cur == NULL) continue;
+                cur->flags &= ~CELL_INCONS;
+                if (!AreSame(cur->g, getRHS(u))) insert(u);
+        }
+        inconsList.clear();
+
+        if (eps == keyEps) return;
+        keyEps = eps;
+
+        for (size_t i = 0; i < openList.size(); i++) {
+                openList.setKeyAt(i, calculateKey(openList.nodeAt(i)));
+        }
+        openList.heapify();
 }
 
 
@@ -340,7 +867,8 @@ void Dstar::remove(Node u) {
  * --------------------------
  * Euclidean cost between Node a and Node b.
  */
-double Dstar::trueDist(Node a, Node b) {
+template <class Connectivity, class CostT>
+double DstarT<Connectivity, CostT>::trueDist(Node a, Node b) {
 
         float x = a.x-b.x;
         float y = a.y-b.y;
@@ -348,317 +876,940 @@ double Dstar::trueDist(Node a, Node b) {
 
 }
 
-/* double Dstar::heuristic(Node a, Node b)
+/* Dist Dstar::heuristic(Node a, Node b)
  * --------------------------
- * Pretty self explanitory, the heristic we use is the 8-way distance
- * scaled by a constant D (should be set to <= min cost).
+ * Pretty self explanitory, the heristic we use is the free space
+ * distance of the connectivity for cells of cost D (should be set
+ * to <= min cost).
  */
-double Dstar::heuristic(Node a, Node b) {
-        return eightCondist(a,b)*D;
+template <class Connectivity, class CostT>
+typename DstarT<Connectivity, CostT>::Dist DstarT<Connectivity, CostT>::heuristic(Node a, Node b) {
+        return Traits::moveCost(Connectivity::distance(a.x-b.x, a.y-b.y, len), D);
 }
 
-/* Node Dstar::calculateKey(Node u)
+/* NodeKey Dstar::calculateKey(Node u)
  * --------------------------
- * As per [S. Koenig, 2002]
+ * As per [S. Koenig, 2002], with the heuristic of overconsistent Nodes
+ * inflated by eps as per [M. Likhachev, 2005]. For eps = 1 this is the
+ * D* Lite key.
  */
-Node Dstar::calculateKey(Node u) {
-
-        double val = fmin(getRHS(u),getG(u));
-
-        u.k.first  = val + heuristic(u,s_start) + k_m;
-        u.k.second = val;
+template <class Connectivity, class CostT>
+typename DstarT<Connectivity, CostT>::NodeKey DstarT<Connectivity, CostT>::calculateKey(Node u) {
+
+        Dist g   = getG(u);
+        Dist rhs = getRHS(u);
+        NodeKey k;
+
+        if (g > rhs) {
+                k.first  = Traits::add(Traits::add(rhs, Traits::inflate(heuristic(u,s_start), eps)), k_m);
+                k.second = rhs;
+        } else {
+                k.first  = Traits::add(Traits::add(g, heuristic(u,s_start)), k_m);
+                k.second = g;
+        }
 
-        return u;
+        return k;
 
 }
 
-/* double Dstar::cost(Node a, Node b)
+/* Dist Dstar::cost(Node a, int move)
  * --------------------------
- * Returns the cost of moving from Node a to Node b. This could be
- * either the cost of moving off Node a or onto Node b, we went with
- * the former. This is also the 8-way cost.
+ * Returns the cost of the given move of the connectivity out of Node a.
+ * This could be either the cost of moving off Node a or onto the
+ * neighbour, we went with the former.
  */
-double Dstar::cost(Node a, Node b) {
-
-        int xd = abs(a.x-b.x);
-        int yd = abs(a.y-b.y);
-        double scale = 1;
+template <class Connectivity, class CostT>
+typename DstarT<Connectivity, CostT>::Dist DstarT<Connectivity, CostT>::cost(Node a, int move) {
 
-        if (xd+yd>1) scale = M_SQRT2;
-
-        if (cellHash.count(a) == 0) return scale*D;
-        return scale*cellHash[a].cost;
+        NodeInfo *cur = findCell(a);
+        if (cur == NULL) return Traits::moveCost(len[move], D);
+        return Traits::moveCost(len[move], cur->cost);
 
 }
 /* void Dstar::updateCell(int x, int y, double val)
  * --------------------------
- * As per [S. Koenig, 2002]
+ * As per [S. Koenig, 2002]. val is converted to the cost type, < 0
+ * meaning occupied.
  */
-void Dstar::updateCell(int x, int y, double val) {
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::updateCell(int x, int y, double val) {
 
         Node u;
 
         u.x = x;
         u.y = y;
 
+        setCellCost(u, Traits::fromDouble(val));
+}
+
+/* void Dstar::setCosts(const unsigned char *costs, const double *table, int y, int x0, int n)
+ * --------------------------
+ * updateCell for the n cells of row y from x0 on, cell x0+i costing
+ * table[costs[i]]. The table is converted to the cost type once, and
+ * with flat-array or tiled storage the cells keeping their cost, most
+ * of a map sent again, are skipped in a loop over the stored row
+ * instead of a call per cell.
+ */
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::setCosts(const unsigned char *costs, const double *table, int y, int x0, int n) {
+
+        CostT val[256];
+        for (int c = 0; c < 256; c++) val[c] = Traits::fromDouble(table[c]);
+
+        Node u;
+        u.y = y;
+
+        if (gridWidth == 0) {
+                for (int i = 0; i < n; i++) {
+                        u.x = x0 + i;
+                        setCellCost(u, val[costs[i]]);
+                }
+                return;
+        }
+
+        if ((y < 0) || (y >= gridHeight)) return;
+        int x1 = min(x0 + n, gridWidth);
+
+        // runs of cells stored next to each other: the row, or the part
+        // of the row in a tile
+        for (int x = max(x0, 0); x < x1;) {
+                u.x = x;
+                int end = (tileCols == 0) ? x1 : min(x1, (x | TILE_MASK) + 1);
+                NodeInfo *run = denseCell(u);
+                int first = x;
+
+                for (; x < end; x++) {
+                        // an uncreated cell costs D, read without a branch:
+                        // only the changed cells, few of them, branch off
+                        CostT v = val[costs[x - x0]];
+                        CostT cur = D;
+                        if (run != NULL) {
+                                const NodeInfo &c = run[x - first];
+                                cur = (c.flags & CELL_CREATED) ? c.cost : D;
+                        }
+                        if (cur == v) continue;
+
+                        Node w;
+                        w.x = x;
+                        w.y = y;
+                        setCellCost(w, v);
+                        if (run == NULL) run = denseCell(u); // the tile is allocated now
+                }
+        }
+}
+
+/* void Dstar::setCellCost(Node u, CostT val)
+ * --------------------------
+ * Sets the cost of a map cell, the start and goal cells and the cells
+ * outside of the flat-array storage are left alone.
+ */
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::setCellCost(Node u, CostT val) {
+
         if ((u == s_start) || (u == s_goal)) return;
+        if ((gridWidth > 0) && !inGrid(u)) return;
 
-        makeNewCell(u);
-        cellHash[u].cost = val;
+        setCost(u, val);
+}
+
+/* void Dstar::setCost(Node u, CostT val)
+ * --------------------------
+ * Sets the cost of Node u and updates the Nodes whose edges changed.
+ * When the cell becomes occupied or free, the edges into it and the
+ * moves cutting its corners change as well, so its neighbours are
+ * updated too.
+ */
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::setCost(Node u, CostT val) {
+
+        Neighbours s;
+
+        // an unseen cell already costs D and a cell keeping its cost
+        // changes no edge, so a sweep over a mostly unchanged map neither
+        // creates cells nor touches the open list
+        NodeInfo *cur = findCell(u);
+        if ((cur == NULL) ? (val == D) : (cur->cost == val)) return;
+
+        bool wasOccupied = occupied(u);
+        NodeInfo &info = cellInfo(u);
+        costsChanged = true;
+        changedCells++;
+        info.cost = val;
 
         updateVertex(u);
+
+        if (wasOccupied != Traits::isOccupied(val)) {
+                getNeighbours(u,s);
+                for (int i=0; i < s.size; i++) {
+                        if (!occupied(s.n[i])) updateVertex(s.n[i]);
+                }
+        }
 }
 
-/* void Dstar::getSucc(Node u,list<Node> &s)
+/* void Dstar::getSucc(Node u, Neighbours &s)
  * --------------------------
- * Returns a list of successor Nodes for Node u, since this is an
- * 8-way graph this list contains all of a cells neighbours. Unless
- * the cell is occupied in which case it has no successors.
+ * Returns the successor Nodes of Node u. The graph is undirected, so
+ * these are the same Nodes as in getPred, unless the cell is occupied
+ * in which case it has no successors.
  */
-void Dstar::getSucc(Node u,list<Node> &s) {
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::getSucc(Node u, Neighbours &s) {
 
-        s.clear();
-        u.k.first  = -1;
-        u.k.second = -1;
+        s.size = 0;
 
         if (occupied(u)) return;
 
-        u.x += 1;
-        s.push_front(u);
-        u.y += 1;
-        s.push_front(u);
-        u.x -= 1;
-        s.push_front(u);
-        u.x -= 1;
-        s.push_front(u);
-        u.y -= 1;
-        s.push_front(u);
-        u.y -= 1;
-        s.push_front(u);
-        u.x += 1;
-        s.push_front(u);
-        u.x += 1;
-        s.push_front(u);
-
-}
-
-/* void Dstar::getPred(Node u,list<Node> &s)
- * --------------------------
- * Returns a list of all the predecessor Nodes for Node u. Since
- * this is for an 8-way connected graph the list contails all the
- * neighbours for Node u. Occupied neighbours are not added to the
- * list.
+        getPred(u,s);
+
+}
+
+/* void Dstar::getNeighbours(Node u, Neighbours &s)
+ * --------------------------
+ * Returns all the neighbours of Node u, one per move of the
+ * connectivity.
  */
-void Dstar::getPred(Node u,list<Node> &s) {
-
-        s.clear();
-        u.k.first  = -1;
-        u.k.second = -1;
-
-        Node ua, ub;
-        // u.x += 1;
-        // if (!occupied(u)) s.push_front(u);
-        // u.y += 1; // TODO
-        // if (!occupied(u)) s.push_front(u);
-        // u.x -= 1;
-        // if (!occupied(u)) s.push_front(u);
-        // u.x -= 1; // TODO
-        // if (!occupied(u)) s.push_front(u);
-        // u.y -= 1;
-        // if (!occupied(u)) s.push_front(u);
-        // u.y -= 1; // TODO
-        // if (!occupied(u)) s.push_front(u);
-        // u.x += 1;
-        // if (!occupied(u)) s.push_front(u);
-        // u.x += 1; // TODO
-        // if (!occupied(u)) s.push_front(u);
-
-        u.x += 1;
-        if (!occupied(u))
-                s.push_front(u);
-        u.y += 1; // Case 1
-
-        ua.x = u.x-1;
-        ua.y = u.y;
-        ub.x = u.x;
-        ub.y = u.y-1;
-        if (!occupied(u) && !occupied(ua) && !occupied(ub) )
-                s.push_front(u);
-
-
-        u.x -= 1;
-        if (!occupied(u)) s.push_front(u);
-
-        u.x -= 1; // Case 2
-        ua.x = u.x+1;
-        ua.y = u.y;
-        ub.x = u.x;
-        ub.y = u.y-1;
-        if (!occupied(u) && !occupied(ua) && !occupied(ub))
-                s.push_front(u);
-
-        u.y -= 1;
-        if (!occupied(u)) s.push_front(u);
-
-        u.y -= 1; // Case 3
-        ua.x = u.x;
-        ua.y = u.y+1;
-        ub.x = u.x+1;
-        ub.y = u.y;
-        if (!occupied(u) && !occupied(ua) && !occupied(ub))
-                s.push_front(u);
-
-        u.x += 1;
-        if (!occupied(u)) s.push_front(u);
-
-        u.x += 1; // Case 4
-        ua.x = u.x;
-        ua.y = u.y+1;
-        ub.x = u.x-1;
-        ub.y = u.y;
-        if (!occupied(u) && !occupied(ua) && !occupied(ub))
-                s.push_front(u);
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::getNeighbours(Node u, Neighbours &s) {
+
+        for (int i = 0; i < Connectivity::N; i++) {
+                s.n[i].x  = u.x + Connectivity::DX[i];
+                s.n[i].y  = u.y + Connectivity::DY[i];
+                s.move[i] = i;
+        }
+        s.size = Connectivity::N;
+
+}
+
+/* void Dstar::getPred(Node u, Neighbours &s)
+ * --------------------------
+ * Returns all the predecessor Nodes of Node u: the neighbours of Node u,
+ * except the occupied ones and the ones whose move would cut the corner
+ * of an occupied cell. The occupancy of the neighbours is read once into
+ * a bit mask and each move is checked against its BLOCK mask.
+ */
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::getPred(Node u, Neighbours &s) {
+
+        Neighbours all;
+        unsigned int occ = 0;
+
+        getNeighbours(u, all);
+        for (int i = 0; i < Connectivity::N; i++) {
+                occ |= (unsigned int)occupied(all.n[i]) << i;
+        }
+
+        s.size = 0;
+        for (int i = 0; i < Connectivity::N; i++) {
+                s.n[s.size]    = all.n[i];
+                s.move[s.size] = i;
+                s.size += ((occ & Connectivity::BLOCK[i]) == 0);
+        }
 
 }
 
 /* void Dstar::updateStart(int x, int y)
  * --------------------------
- * Update the position of the robot, this does not force a replan.
+ * Update the position of the robot, this does not force a replan. With
+ * flat-array storage it is moved onto the grid (see clampToGrid).
  */
-void Dstar::updateStart(int x, int y) {
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::updateStart(int x, int y) {
 
         s_start.x = x;
         s_start.y = y;
+        clampToGrid(s_start);
 
-        k_m += heuristic(s_last,s_start);
+        // the keys on the openList stay lower bounds as long as k_m grows
+        // at least as much as their (inflated) heuristic can drop
+        k_m = Traits::add(k_m, Traits::inflate(heuristic(s_last,s_start), eps));
 
-        s_start = calculateKey(s_start);
         s_last  = s_start;
 
+        // the robot is always on a traversable cell, whatever the map says
+        NodeInfo *cur = findCell(s_start);
+        if ((cur != NULL) && (cur->cost != D)) setCost(s_start, D);
+
 }
 
 /* void Dstar::updateGoal(int x, int y)
  * --------------------------
- * This is somewhat of a hack, to change the position of the goal we
- * first save all of the non-empty on the map, clear the map, move the
- * goal, and re-add all of non-empty cells. Since most of these cells
- * are not between the start and goal this does not seem to hurt
- * performance too much. Also it free's up a good deal of memory we
- * likely no longer use.
+ * Nothing to do if the goal did not move. Otherwise, in the spirit of
+ * MT-D* Lite [X. Sun, 2010], the search tree rooted at the old goal is
+ * pruned: the subtree hanging below the new goal keeps its g values,
+ * shifted by g(new goal), since their paths already lead through it. All
+ * the other cells are cleared back to the free space assumption and the
+ * non-empty cells of the map are re-added, as D* Lite is then able to
+ * repair the rest of the tree. With flat-array storage the goal is moved
+ * onto the grid first (see clampToGrid).
  */
-void Dstar::updateGoal(int x, int y) {
-
-        list< pair<ipoint2, double> > toAdd;
-        pair<ipoint2, double> tp;
-
-        ds_ch::iterator i;
-        list< pair<ipoint2, double> >::iterator kk;
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::updateGoal(int x, int y) {
+
+        Node goal;
+        goal.x = x;
+        goal.y = y;
+        clampToGrid(goal);
+
+        if (goal == s_goal) return;
+
+        list< pair<Node, CostT> > toAdd;
+        pair<Node, CostT> tp;
+
+        typename ds_ch::iterator i;
+        typename list< pair<Node, CostT> >::iterator kk;
+
+        list< pair<Node, NodeInfo> > keep;
+        typename list< pair<Node, NodeInfo> >::iterator kp;
+        getSubtree(goal, keep);
+
+        if (tileCols > 0) {
+                for (size_t t = 0; t < tiles.size(); t++) {
+                        for (size_t idx = 0; idx < tiles[t].size(); idx++) {
+                                if ((tiles[t][idx].flags & CELL_CREATED) &&
+                                    (tiles[t][idx].cost != D)) {
+                                        tp.first.x = (t % tileCols)*TILE_SIZE + (idx & TILE_MASK);
+                                        tp.first.y = (t / tileCols)*TILE_SIZE + (idx >> TILE_SHIFT);
+                                        tp.second = tiles[t][idx].cost;
+                                        toAdd.push_back(tp);
+                                }
+                        }
+                }
+        } else if (gridWidth > 0) {
+                for (size_t idx = 0; idx < grid.size(); idx++) {
+                        if ((grid[idx].flags & CELL_CREATED) &&
+                            (grid[idx].cost != D)) {
+                                tp.first.x = idx % gridWidth;
+                                tp.first.y = idx / gridWidth;
+                                tp.second = grid[idx].cost;
+                                toAdd.push_back(tp);
+                        }
+                }
+        }
 
         for(i=cellHash.begin(); i!=cellHash.end(); i++) {
-                if (!AreSame(i->second.cost, D)) {
-                        tp.first.x = i->first.x;
-                        tp.first.y = i->first.y;
+                if (i->second.cost != D) {
+                        tp.first = i->first;
                         tp.second = i->second.cost;
                         toAdd.push_back(tp);
                 }
         }
 
-        cellHash.clear();
-        openHash.clear();
-
-        while(!openList.empty())
-                openList.pop();
+        clearCells();
 
         k_m = 0;
+        costsChanged = true; // the next anytime search restarts from epsStart
+
+        // a moved goal invalidates the whole search tree, whatever the
+        // storage: scratchDue counts it as a change of every cell
+        goalMoved = true;
 
-        s_goal.x  = x;
-        s_goal.y  = y;
+        s_goal = goal;
 
         NodeInfo tmp;
         tmp.g = tmp.rhs =  0;
         tmp.cost = D;
+        tmp.heapIndex = -1;
+        tmp.flags = CELL_CREATED;
 
-        cellHash[s_goal] = tmp;
+        cellInfo(s_goal) = tmp;
 
-        tmp.g = tmp.rhs = heuristic(s_start,s_goal);
-        tmp.cost = D;
-        cellHash[s_start] = tmp;
-        s_start = calculateKey(s_start);
+        for (kp=keep.begin(); kp != keep.end(); kp++) {
+                cellInfo(kp->first) = kp->second;
+        }
+
+        makeNewCell(s_start);
+        cellInfo(s_start).cost = D;
 
         s_last = s_start;
 
         for (kk=toAdd.begin(); kk != toAdd.end(); kk++) {
-                updateCell(kk->first.x, kk->first.y, kk->second);
+                setCellCost(kk->first, kk->second);
         }
 
+        // the free space assumption of the cells around the subtree does
+        // not hold any more
+        Neighbours s;
+        for (kp=keep.begin(); kp != keep.end(); kp++) {
+                updateVertex(kp->first);
+                getNeighbours(kp->first, s);
+                for (int j=0; j < s.size; j++) {
+                        if (!occupied(s.n[j])) updateVertex(s.n[j]);
+                }
+        }
 
 }
 
+/* void Dstar::getSubtree(Node root, list< pair<Node, NodeInfo> > &keep)
+ * --------------------------
+ * Collects the cells whose greedy path to the goal goes through root,
+ * i.e. cells u with g(u) = cost(u,v) + g(v) for a collected v, starting
+ * from root. Their g and rhs are returned relative to root, which is the
+ * cost of the path from u to root. Only cells with their own NodeInfo
+ * are followed, root itself is not returned.
+ */
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::getSubtree(Node root, list< pair<Node, NodeInfo> > &keep) {
+
+        keep.clear();
+
+        NodeInfo *cur = findCell(root);
+        if ((cur == NULL) || AreSame(cur->g, Traits::INF())) return;
+        Dist offset = cur->g;
+
+        hash_map<Node, bool, Node_hash, equal_to<Node> > visited;
+        list<Node> open;
+        Neighbours s;
+
+        visited[root] = true;
+        open.push_back(root);
+
+        while (!open.empty()) {
+                Node w = open.front();
+                open.pop_front();
+                Dist gw = getG(w);
+
+                getPred(w, s);
+                for (int i=0; i < s.size; i++) {
+                        Node v = s.n[i];
+                        if (visited.find(v) != visited.end()) continue;
+                        NodeInfo *info = findCell(v);
+                        if ((info == NULL) || AreSame(info->g, Traits::INF())) continue;
+                        if (!AreSame(info->g, Traits::add(cost(v,s.move[i]), gw))) continue;
+
+                        visited[v] = true;
+                        open.push_back(v);
+
+                        NodeInfo tmp = *info;
+                        tmp.g = tmp.rhs = info->g - offset;
+                        tmp.heapIndex = -1;
+                        tmp.flags = CELL_CREATED;
+                        keep.push_back(make_pair(v, tmp));
+                }
+        }
+}
+
+/* int Dstar::resumeSearch(Clock::time_point deadline)
+ * --------------------------
+ * Carries on with a suspended search, or starts a new one if the last
+ * search completed or eps changed since, and runs it until the deadline.
+ * Returns the result of computeShortestPath.
+ */
+template <class Connectivity, class CostT>
+int DstarT<Connectivity, CostT>::resumeSearch(Clock::time_point deadline) {
+
+        if (!searchSuspended) {
+                changedCells = 0;
+                goalMoved = false;
+        }
+        if (!searchSuspended || (eps != keyEps)) beginSearch();
+
+        Clock::time_point t0 = Clock::now();
+        int res = computeShortestPath(deadline);
+        stats.searchTime += std::chrono::duration<double>(Clock::now() - t0).count();
+        searchSuspended = (res != 0);
+        return res;
+}
+
 /* bool Dstar::replan()
  * --------------------------
  * Updates the costs for all cells and computes the shortest path to
- * goal. Returns true if a path is found, false otherwise. The path is
- * computed by doing a greedy search over the cost+g values in each
- * cells. In order to get around the problem of the robot taking a
- * path that is near a 45 degree angle to goal we break ties based on
- *  the metric euclidean(Node, goal) + euclidean(Node,start).
+ * goal, see scratchDue for when A* from scratch is used instead. Returns
+ * true if a path is found, false otherwise.
  */
-bool Dstar::replan() {
+template <class Connectivity, class CostT>
+bool DstarT<Connectivity, CostT>::replan() {
 
-        path.clear();
+        retirePath();
 
-        int res = computeShortestPath();
-        //printf("res: %d ols: %d ohs: %d tk: [%f %f] sk: [%f %f] sgr: (%f,%f)\n",res,openList.size(),openHash.size(),openList.top().k.first,openList.top().k.second, s_start.k.first, s_start.k.second,getRHS(s_start),getG(s_start));
+        if (scratchDue()) return (replanScratch(0) == PLAN_FOUND);
+
+        int res = resumeSearch(Clock::time_point::max());
         if (res < 0) {
                 fprintf(stderr, "NO PATH TO GOAL\n");
+                endReplan();
                 return false;
         }
-        list<Node> n;
-        list<Node>::iterator i;
+
+        pathEps = eps;
+        bool found = timedExtractPath();
+        endReplan();
+        return found;
+}
+
+/* PlanStatus Dstar::replanFor(double timeBudget)
+ * --------------------------
+ * Same as replan, but the search stops after timeBudget seconds. It then
+ * returns PLAN_INCOMPLETE without a path and the next call, to replan or
+ * replanFor, resumes it.
+ */
+template <class Connectivity, class CostT>
+PlanStatus DstarT<Connectivity, CostT>::replanFor(double timeBudget) {
+
+        retirePath();
+
+        if (scratchDue()) return replanScratch(timeBudget);
+
+        Clock::time_point deadline = Clock::now() +
+                std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeBudget));
+
+        PlanStatus status = PLAN_INCOMPLETE;
+        if (resumeSearch(deadline) == 0) {
+                pathEps = eps;
+                status = timedExtractPath() ? PLAN_FOUND : PLAN_NO_PATH;
+        }
+
+        endReplan();
+        return status;
+}
+
+/* void Dstar::endReplan()
+ * --------------------------
+ * Makes the statistics counted since the last replan available to
+ * getStats and starts counting again.
+ */
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::endReplan() {
+
+        stats.cells = cellCount;
+        stats.tiles = tileCount;
+        lastStats = stats;
+        stats = SearchStats();
+}
+
+/* SearchStats Dstar::getStats()
+ * --------------------------
+ * Returns the statistics of the last replan, replanFor or replanAnytime
+ * call, including the cost updates made before it.
+ */
+template <class Connectivity, class CostT>
+SearchStats DstarT<Connectivity, CostT>::getStats() {
+        return lastStats;
+}
+
+/* void Dstar::setScratchFraction(double fraction)
+ * --------------------------
+ * Sets the share of changed cells above which replan and replanFor use
+ * A* from scratch instead of D* Lite, see scratchDue. 0 always repairs.
+ */
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::setScratchFraction(double fraction) {
+        scratchFraction = (fraction > 0) ? fraction : 0;
+}
+
+/* bool Dstar::scratchDue()
+ * --------------------------
+ * True if more than scratchFraction of the cells known to the planner
+ * (the whole grid with flat-array storage) changed cost since the last
+ * search began, a moved goal counting as a change of every cell.
+ * Repairing the search tree then costs more than a search from scratch.
+ */
+template <class Connectivity, class CostT>
+bool DstarT<Connectivity, CostT>::scratchDue() {
+
+        if (scratchFraction <= 0) return false;
+        if (goalMoved) return scratchFraction < 1;
+        size_t known = (gridWidth > 0) ? (size_t)gridWidth*gridHeight : cellHash.size();
+        return changedCells > scratchFraction*known;
+}
+
+/* PlanStatus Dstar::replanScratch(double timeBudget)
+ * --------------------------
+ * Answers a replan with A* from scratch, under the limit of the replan
+ * (see planFromScratch), whose work is counted in the statistics of the
+ * replan. The repair of the D* Lite search tree is left to the next
+ * replan, the changes wait on the openList until then.
+ */
+template <class Connectivity, class CostT>
+PlanStatus DstarT<Connectivity, CostT>::replanScratch(double timeBudget) {
+
+        SearchStats work;
+        list<Node> scratchPath;
+        PlanStatus status = planFromScratch(ENGINE_ASTAR, scratchPath, work, timeBudget);
+        path.assign(scratchPath.begin(), scratchPath.end());
+
+        stats.expansions  += work.expansions;
+        stats.heapPushes  += work.heapPushes;
+        stats.heapUpdates += work.heapUpdates;
+        stats.heapRemoves += work.heapRemoves;
+        stats.searchTime  += work.searchTime;
+        stats.extractTime += work.extractTime;
+        if (work.peakOpenList > stats.peakOpenList) stats.peakOpenList = work.peakOpenList;
+        pathEps = 1;
+        changedCells = 0;
+        goalMoved = false;
+
+        endReplan();
+        return status;
+}
+
+/* ScratchCell &Dstar::scratchCell(const Node &u, scratch_ch &cells)
+ * --------------------------
+ * Returns the planFromScratch state of Node u, reset if it was last
+ * touched by an earlier search. Flat-array storage keeps the states in
+ * scratchGrid, hash and tiled storage in cells.
+ */
+template <class Connectivity, class CostT>
+typename DstarT<Connectivity, CostT>::ScratchCell &DstarT<Connectivity, CostT>::scratchCell(const Node &u, scratch_ch &cells) {
+
+        ScratchCell *c;
+        if (tileCols == 0 && gridWidth > 0) c = &scratchGrid[(size_t)u.y*gridWidth + u.x];
+        else c = &cells[u];
+
+        if (c->stamp != scratchStamp) {
+                c->g = Traits::INF();
+                c->heapIndex = -1;
+                c->move = -1;
+                c->stamp = scratchStamp;
+        }
+        return *c;
+}
+
+/* PlanStatus Dstar::planFromScratch(SearchEngine engine, list<Node> &scratchPath, SearchStats &work, double timeBudget)
+ * --------------------------
+ * Plans from s_start to s_goal on the current cell costs with a forward
+ * search that reuses nothing, A* or Dijkstra, as a baseline for the
+ * incremental search. Moves and costs are the ones of D* Lite, so both
+ * find paths of the same cost. The D* Lite state, path and statistics
+ * are left alone: the path is returned in scratchPath and the work done
+ * in work. The search is cut off as D* Lite would be: after timeBudget
+ * seconds if it is > 0, as replanFor, else on hash storage after maxSteps
+ * expansions, as replan, the grid being unbounded. A cut off search
+ * returns PLAN_INCOMPLETE without a path.
+ */
+template <class Connectivity, class CostT>
+PlanStatus DstarT<Connectivity, CostT>::planFromScratch(SearchEngine engine, list<Node> &scratchPath, SearchStats &work, double timeBudget) {
+
+        scratchPath.clear();
+        work = SearchStats();
+
+        if ((gridWidth > 0) && (!inGrid(s_start) || !inGrid(s_goal))) return PLAN_NO_PATH;
+
+        Clock::time_point t0 = Clock::now();
+        bool bounded = (timeBudget > 0);
+        Clock::time_point deadline = t0 +
+                std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(bounded ? timeBudget : 0));
+
+        if (scratchGrid.size() != grid.size()) {
+                scratchGrid.assign(grid.size(), ScratchCell());
+                scratchStamp = 0;
+        }
+        if (++scratchStamp == 0) { // wrapped around, forget every stamp
+                for (size_t i = 0; i < scratchGrid.size(); i++) scratchGrid[i].stamp = 0;
+                scratchStamp = 1;
+        }
+
+        bool astar = (engine == ENGINE_ASTAR);
+        scratch_ch cells;
+        Neighbours s;
+        NodeKey k;
+
+        ScratchCell &start = scratchCell(s_start, cells);
+        start.g = 0;
+        k.first = astar ? heuristic(s_start, s_goal) : 0;
+        k.second = 0;
+        scratchList.clear();
+        scratchList.push(s_start, k, &start.heapIndex);
+        work.heapPushes++;
+
+        bool found = false, cutOff = false;
+        while (!scratchList.empty()) {
+                Node u = scratchList.top();
+                ScratchCell &cu = scratchCell(u, cells);
+                scratchList.remove(&cu.heapIndex);
+                work.heapRemoves++;
+
+                if (u == s_goal) {
+                        found = true;
+                        break;
+                }
+                if (bounded ? (((work.expansions & 63) == 63) && (Clock::now() >= deadline))
+                            : ((gridWidth == 0) && ((int)work.expansions >= maxSteps))) {
+                        cutOff = true;
+                        break;
+                }
+                work.expansions++;
+
+                getSucc(u, s);
+                for (int i = 0; i < s.size; i++) {
+                        ScratchCell &cv = scratchCell(s.n[i], cells);
+                        Dist g = Traits::add(cu.g, cost(u, s.move[i]));
+                        if (!(g < cv.g)) continue;
+
+                        cv.g = g;
+                        cv.move = s.move[i];
+                        k.first = astar ? Traits::add(g, heuristic(s.n[i], s_goal)) : g;
+                        k.second = g;
+                        if (cv.heapIndex < 0) work.heapPushes++;
+                        else work.heapUpdates++;
+                        scratchList.update(s.n[i], k, &cv.heapIndex);
+                        if (scratchList.size() > work.peakOpenList) work.peakOpenList = scratchList.size();
+                }
+        }
+        scratchList.clear();
+
+        Clock::time_point t1 = Clock::now();
+        work.searchTime = std::chrono::duration<double>(t1 - t0).count();
+        if (cutOff) return PLAN_INCOMPLETE;
+        if (!found) return PLAN_NO_PATH;
+
+        // walk the parent moves back from the goal
+        Node u = s_goal;
+        while (u != s_start) {
+                scratchPath.push_front(u);
+                int m = scratchCell(u, cells).move;
+                u.x -= Connectivity::DX[m];
+                u.y -= Connectivity::DY[m];
+        }
+        scratchPath.push_front(s_start);
+        work.extractTime = std::chrono::duration<double>(Clock::now() - t1).count();
+        return PLAN_FOUND;
+}
+
+/* void Dstar::setAnytime(double epsStart, double epsStep)
+ * --------------------------
+ * Configures replanAnytime: the first search after a cost change uses
+ * the heuristic inflated by epsStart, every further search lowers eps
+ * by epsStep down to 1. epsStart = 1 is plain D* Lite.
+ */
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::setAnytime(double epsStart, double epsStep) {
+
+        this->epsStart = (epsStart > 1) ? epsStart : 1;
+        this->epsStep  = (epsStep > 0) ? epsStep : this->epsStart - 1;
+        eps = this->epsStart;
+        costsChanged = true;
+}
+
+/* double Dstar::getEpsilon()
+ * --------------------------
+ * Returns the suboptimality bound of the last path found: its cost is at
+ * most eps times the optimal one.
+ */
+template <class Connectivity, class CostT>
+double DstarT<Connectivity, CostT>::getEpsilon() {
+        return pathEps;
+}
+
+/* PlanStatus Dstar::replanAnytime(double timeBudget)
+ * --------------------------
+ * Anytime D* [M. Likhachev, 2005]. If a cell cost or the goal changed
+ * since the last call, eps goes back to epsStart and the current search
+ * tree is repaired with the inflated heuristic, otherwise the search
+ * resumes at the current eps. Then, as long as eps > 1 and timeBudget
+ * (seconds) is not spent, eps is lowered and the path improved. A search
+ * still running at the deadline is suspended and resumed by the next
+ * call, the path is the one of the last completed search of this call
+ * and PLAN_INCOMPLETE is returned if there is none.
+ */
+template <class Connectivity, class CostT>
+PlanStatus DstarT<Connectivity, CostT>::replanAnytime(double timeBudget) {
+
+        Clock::time_point deadline = Clock::now() +
+                std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(timeBudget));
+
+        if (costsChanged) eps = epsStart;
+        costsChanged = false;
+
+        vector<Node> best;
+        PlanStatus status = PLAN_INCOMPLETE;
+
+        while (resumeSearch(deadline) == 0) {
+                if (timedExtractPath()) {
+                        best    = path;
+                        pathEps = eps;
+                        status  = PLAN_FOUND;
+                } else if (status != PLAN_FOUND) {
+                        status = PLAN_NO_PATH;
+                        break;
+                }
+
+                if ((eps <= 1) || (Clock::now() >= deadline)) break;
+
+                eps -= epsStep;
+                if (eps < 1) eps = 1;
+        }
+
+        path = best;
+        endReplan();
+        return status;
+}
+
+/* bool Dstar::timedExtractPath()
+ * --------------------------
+ * extractPath, with its time counted in the statistics.
+ */
+template <class Connectivity, class CostT>
+bool DstarT<Connectivity, CostT>::timedExtractPath() {
+
+        Clock::time_point t0 = Clock::now();
+        bool found = extractPath();
+        stats.extractTime += std::chrono::duration<double>(Clock::now() - t0).count();
+        return found;
+}
+
+/* void Dstar::retirePath()
+ * --------------------------
+ * Empties the path, keeping it as the previous path for extractPath. A
+ * replan that finds no path leaves the older one in place.
+ */
+template <class Connectivity, class CostT>
+void DstarT<Connectivity, CostT>::retirePath() {
+
+        if (!path.empty()) path.swap(lastPath);
+        path.clear();
+}
+
+/* bool Dstar::followLastPath(Node &cur)
+ * --------------------------
+ * If Node cur is on the previous path, appends to the path the part of
+ * the previous path from cur on whose steps are still a greedy choice:
+ * each of its cells is consistent and has its g value given by the move
+ * to the next cell, which thus has the lowest cost+g of all successors.
+ * Only ties may be broken another way than by the walk of extractPath,
+ * the path costs the same. cur becomes the first cell not taken over,
+ * s_goal if the whole rest of the previous path was. Returns false if
+ * cur is not on the previous path.
+ */
+template <class Connectivity, class CostT>
+bool DstarT<Connectivity, CostT>::followLastPath(Node &cur) {
+
+        size_t i = 0;
+        while ((i < lastPath.size()) && (lastPath[i] != cur)) i++;
+        if (i == lastPath.size()) return false;
+
+        for (; i + 1 < lastPath.size(); i++) {
+
+                Node u = lastPath[i];
+                Node v = lastPath[i+1];
+                int move = 0;
+                while ((move < Connectivity::N) &&
+                       ((u.x + Connectivity::DX[move] != v.x) || (u.y + Connectivity::DY[move] != v.y))) move++;
+                if ((move == Connectivity::N) || blocked(u, move)) break;
+
+                Dist g = getG(u);
+                if (!AreSame(g, getRHS(u)) || !AreSame(g, Traits::add(cost(u,move), getG(v)))) break;
+
+                path.push_back(u);
+                stats.pathReused++;
+        }
+        cur = lastPath[i];
+        return true;
+}
+
+/* bool Dstar::extractPath()
+ * --------------------------
+ * Computes the path by doing a greedy search over the cost+g values in
+ * each cells. In order to get around the problem of the robot taking a
+ * path that is near a 45 degree angle to goal we break ties based on
+ *  the metric euclidean(Node, goal) + euclidean(Node,start), only
+ * computed for the successors that tie. Once the walk reaches the
+ * previous path, in its first PATH_REJOIN_STEPS steps, the part of it
+ * that is still consistent is taken over (followLastPath) and the walk
+ * carries on from where it stops being so: a long path is not walked
+ * again when the map only changed around its start.
+ */
+template <class Connectivity, class CostT>
+bool DstarT<Connectivity, CostT>::extractPath() {
+
+        retirePath();
+
+        Neighbours n;
 
         Node cur = s_start;
 
-        if (std::isinf(getG(s_start))) {
+        if (AreSame(getG(s_start), Traits::INF())) {
                 fprintf(stderr, "Start node is not valid, No path\n");
                 return false;
         }
 
+        bool rejoin = !lastPath.empty() && (lastPath.back() == s_goal);
+
         while(cur != s_goal) {
 
+                if (rejoin && (path.size() < PATH_REJOIN_STEPS) && followLastPath(cur)) {
+                        rejoin = false;
+                        if (cur == s_goal) break;
+                }
+
                 path.push_back(cur);
                 getSucc(cur, n);
 
-                if (n.empty()) {
+                if (n.size == 0) {
                         fprintf(stderr, "Path is empty\n");
+                        path.clear();
                         return false;
                 }
 
-                double cmin = INFINITY;
-                double tmin;
+                // the g values of an eps-suboptimal search may not be
+                // locally consistent, do not follow a loop forever
+                if ((int)path.size() > maxSteps) {
+                        fprintf(stderr, "Path is too long\n");
+                        path.clear();
+                        return false;
+                }
+
+                Dist cmin = Traits::INF();
+                double tmin = INFINITY; // < 0 until a tie needs it
                 Node smin;
 
-                for (i=n.begin(); i!=n.end(); i++) {
+                for (int i=0; i<n.size; i++) {
 
-                        //if (occupied(*i)) continue;
-                        double val  = cost(cur,*i);
-                        double val2 = trueDist(*i,s_goal) + trueDist(s_start,*i);   // (Euclidean) cost to goal + cost to pred
-                        val += getG(*i);
+                        Dist val = Traits::add(cost(cur,n.move[i]), getG(n.n[i]));
 
                         if (AreSame(val,cmin)) {
+                                // (Euclidean) cost to goal + cost to pred
+                                double val2 = trueDist(n.n[i],s_goal) + trueDist(s_start,n.n[i]);
+                                if (tmin < 0) tmin = trueDist(smin,s_goal) + trueDist(s_start,smin);
                                 if (tmin > val2) {
                                         tmin = val2;
                                         cmin = val;
-                                        smin = *i;
+                                        smin = n.n[i];
                                 }
                         } else if (val < cmin) {
-                                tmin = val2;
+                                tmin = -1;
                                 cmin = val;
-                                smin = *i;
+                                smin = n.n[i];
                         }
                 }
-                n.clear();
                 cur = smin;
         }
         path.push_back(s_goal);
         return true;
 }
+
+template <class Connectivity>
+static DstarBase *makeDstarCost(const std::string &costType) {
+
+        if (costType == "double") return new DstarT<Connectivity, double>();
+        if (costType == "uint32") return new DstarT<Connectivity, uint32_t>();
+        if (costType == "uint16") return new DstarT<Connectivity, uint16_t>();
+        return NULL;
+}
+
+/* DstarBase *makeDstar(int connectivity, const std::string &costType)
+ * --------------------------
+ * Returns a new planner for a 4, 8 or 16 connected grid storing its
+ * costs as double, uint32 or uint16, NULL for any other combination.
+ */
+DstarBase *makeDstar(int connectivity, const std::string &costType) {
+
+        switch (connectivity) {
+        case 4:  return makeDstarCost<FourConnected>(costType);
+        case 8:  return makeDstarCost<EightConnected>(costType);
+        case 16: return makeDstarCost<SixteenConnected>(costType);
+        }
+        return NULL;
+}
+
+template class OpenList< Key<double> >;
+template class OpenList< Key<uint32_t> >;
+
+template class DstarT<FourConnected, double>;
+template class DstarT<FourConnected, uint32_t>;
+template class DstarT<FourConnected, uint16_t>;
+template class DstarT<EightConnected, double>;
+template class DstarT<EightConnected, uint32_t>;
+template class DstarT<EightConnected, uint16_t>;
+template class DstarT<SixteenConnected, double>;
+template class DstarT<SixteenConnected, uint32_t>;
+template class DstarT<SixteenConnected, uint16_t>;
@@ -0,0 +1,150 @@
+/**
+ * @Filename: costmap_ingest.cpp
+ * Incremental transfer of the costmap char map into the D* Lite planner.
+ * You may use, distribute and modify this code under the
+ * terms of the BSD license.
+ */
+
+#include "Dstar_lite_planning/costmap_ingest.h"
+#include <string.h>
+#include <math.h>
+
+// bytes compared at once while looking for changed cells in a row,
+// memcmp compares whole blocks with vector instructions
+#define INGEST_BLOCK 64
+
+CostmapIngest::CostmapIngest() {
+
+        width_ = height_ = 0;
+        recorder_ = NULL;
+        tracking_ = reloaded_ = false;
+        for (int c = 0; c < 256; c++) table_[c] = translateCost(c);
+}
+
+/* double CostmapIngest::translateCost(unsigned char c)
+ * --------------------------
+ * Same cost mapping as the original full sweep of SrlDstarLite::plan.
+ */
+double CostmapIngest::translateCost(unsigned char c) {
+
+        if (c >= COST_POSSIBLY_CIRCUMSCRIBED) return -1;
+        if (c == COST_FREE_SPACE) return 1;
+        return (double)c;
+}
+
+void CostmapIngest::costCurve(double *table, int lethal, double scale, double exponent) {
+
+        for (int c = 0; c < 256; c++) {
+                if (c >= lethal) table[c] = -1;
+                else if (c == COST_FREE_SPACE) table[c] = 1;
+                else table[c] = fmax(1.0, scale*pow((double)c, exponent));
+        }
+}
+
+void CostmapIngest::setCostTable(const double *table) {
+        memcpy(table_, table, sizeof(table_));
+}
+
+void CostmapIngest::reset() {
+
+        shadow_.clear();
+        touched_.clear();
+        width_ = height_ = 0;
+}
+
+void CostmapIngest::touch(int x, int y) {
+
+        if (x < 0 || y < 0 || x >= width_ || y >= height_) return;
+        touched_.push_back(y*width_ + x);
+}
+
+void CostmapIngest::setRecorder(PlanRecorder *recorder) {
+        recorder_ = recorder;
+}
+
+void CostmapIngest::trackChanges(bool on) {
+
+        tracking_ = on;
+        clearChanges();
+}
+
+void CostmapIngest::clearChanges() {
+
+        changes_.clear();
+        reloaded_ = false;
+}
+
+/* void CostmapIngest::forward(const unsigned char *grid, int index, DstarBase *planner)
+ * --------------------------
+ * Sends the cell at index to the planner and records it in the shadow.
+ */
+void CostmapIngest::forward(const unsigned char *grid, int index, DstarBase *planner) {
+
+        if (tracking_ && shadow_[index] != grid[index]) changes_.push_back(index);
+        shadow_[index] = grid[index];
+        planner->updateCell(index % width_, index / width_, table_[grid[index]]);
+        if (recorder_ != NULL) recorder_->cell(index, grid[index]);
+}
+
+int CostmapIngest::ingest(const unsigned char *grid, int width, int height, DstarBase *planner) {
+        return ingestRect(grid, width, height, 0, 0, width, height, planner);
+}
+
+/* int CostmapIngest::ingestRect(const unsigned char *grid, int width, int height,
+ *                               int x0, int y0, int w, int h, DstarBase *planner)
+ * --------------------------
+ * The first call, or a call after the map size changed, forwards every
+ * cell. Later calls compare the rectangle row by row against the shadow
+ * copy, skipping equal rows and blocks with memcmp.
+ */
+int CostmapIngest::ingestRect(const unsigned char *grid, int width, int height,
+                              int x0, int y0, int w, int h, DstarBase *planner) {
+
+        int changed = 0;
+
+        if (width != width_ || height != height_ || shadow_.empty()) {
+                width_  = width;
+                height_ = height;
+                shadow_.assign(grid, grid + (size_t)width*height);
+                touched_.clear();
+                if (tracking_) reloaded_ = true;
+                for (int y = 0; y < height; y++) {
+                        planner->setCosts(grid + (size_t)y*width, table_, y, 0, width);
+                }
+                if (recorder_ != NULL) {
+                        for (int i = 0; i < width*height; i++) recorder_->cell(i, grid[i]);
+                }
+                return width*height;
+        }
+
+        for (size_t i = 0; i < touched_.size(); i++) {
+                forward(grid, touched_[i], planner);
+                changed++;
+        }
+        touched_.clear();
+
+        int x1 = (x0 + w < width) ? x0 + w : width;
+        int y1 = (y0 + h < height) ? y0 + h : height;
+        if (x0 < 0) x0 = 0;
+        if (y0 < 0) y0 = 0;
+        if (x0 >= x1 || y0 >= y1) return changed;
+
+        for (int y = y0; y < y1; y++) {
+                int row = y*width;
+                if (memcmp(grid + row + x0, &shadow_[row + x0], x1 - x0) == 0) continue;
+
+                for (int bx = x0; bx < x1; bx += INGEST_BLOCK) {
+                        int n = (x1 - bx < INGEST_BLOCK) ? x1 - bx : INGEST_BLOCK;
+                        if (memcmp(grid + row + bx, &shadow_[row + bx], n) == 0) continue;
+
+                        for (int x = bx; x < bx + n; x++) {
+                                if (grid[row + x] != shadow_[row + x]) {
+                                        forward(grid, row + x, planner);
+                                        changed++;
+                                }
+                        }
+                }
+        }
+
+        return changed;
+}
@@ -0,0 +1,240 @@
+/**
+ * @Filename: dstar_server.cpp
+ * Planning server for a fleet: the paths of all the robots heading to the
+ * same goal come out of one D* Lite search tree (see GoalTrees), repaired
+ * once per costmap update, so that the planning load follows the number
+ * of goals and not the number of robots.
+ *   rosrun Dstar_lite_planning dstar_server costmap:=/map_server/costmap \
+ *          costmap_updates:=/map_server/costmap_updates
+ * The costmap is the one published by a costmap_2d node, the paths are
+ * served on ~make_plan (nav_msgs/GetPlan, the tolerance is not used).
+ * You may use, distribute and modify this code under the
+ * terms of the BSD license.
+ */
+
+#include <ros/ros.h>
+#include <tf/transform_datatypes.h>
+#include <nav_msgs/GetPlan.h>
+#include <nav_msgs/OccupancyGrid.h>
+#include <map_msgs/OccupancyGridUpdate.h>
+
+#include <Dstar_lite_planning/goal_trees.h>
+
+#include <math.h>
+#include <string>
+#include <vector>
+
+/* unsigned char charCost(int8_t v)
+ * --------------------------
+ * Costmap cost of a cell of the published costmap, the inverse of the
+ * translation of costmap_2d: 0 free, 1..98 for 1..252, 99 inscribed, 100
+ * lethal and -1 unknown.
+ */
+static unsigned char charCost(int8_t v) {
+
+        if (v < 0) return 255;
+        if (v == 0) return 0;
+        if (v >= 100) return 254;
+        if (v == 99) return 253;
+        return (unsigned char)(1 + ((v - 1)*251 + 48)/97);
+}
+
+class DstarServer {
+
+public:
+
+DstarServer();
+
+private:
+
+ros::NodeHandle nh_;
+ros::Subscriber sub_costmap_;
+ros::Subscriber sub_costmap_updates_;
+ros::ServiceServer srv_plan_;
+
+GoalTrees trees_;
+nav_msgs::MapMetaData info_;     ///<  @brief Geometry of the last costmap
+std::string frame_;     ///<  @brief Frame of the last costmap, of the requests and of the paths
+std::vector<unsigned char> patch_;     ///<  @brief Costs of the last message, translated
+
+int CONNECTIVITY_;     ///<  @brief Moves of the planners: 4, 8 or 16
+std::string COST_TYPE_;     ///<  @brief Cost storage of the planners: double, uint32 or uint16
+double PLANNING_TIME_;     ///<  @brief Deadline of a query or of the repair of a tree in seconds, <= 0 for none
+bool TILED_GRID_ON_;     ///<  @brief Dense storage of the planners in 64x64 tiles allocated on first use
+int MAX_GOALS_;     ///<  @brief Trees kept at most, the least recently queried one makes room for a new goal
+double GOAL_TIMEOUT_;     ///<  @brief Seconds without a query after which the tree of a goal is dropped
+int LETHAL_COST_;     ///<  @brief First costmap cost the planners take as occupied
+double COST_SCALE_;     ///<  @brief Factor of the curve translating costmap costs into planner costs
+double COST_EXPONENT_;     ///<  @brief Exponent of the curve translating costmap costs into planner costs
+
+bool callbackPlan(nav_msgs::GetPlan::Request &req, nav_msgs::GetPlan::Response &res);
+void callbackCostmap(const nav_msgs::OccupancyGrid::ConstPtr& msg);
+void callbackCostmapUpdates(const map_msgs::OccupancyGridUpdate::ConstPtr& msg);
+void repairTrees();
+bool worldToMap(double wx, double wy, int &mx, int &my);
+};
+
+DstarServer::DstarServer() : nh_("~") {
+
+        CONNECTIVITY_ = 8;
+        COST_TYPE_ = "double";
+        PLANNING_TIME_ = 0.2;
+        TILED_GRID_ON_ = false;
+        MAX_GOALS_ = 8;
+        GOAL_TIMEOUT_ = 60.0;
+        LETHAL_COST_ = COST_POSSIBLY_CIRCUMSCRIBED;
+        COST_SCALE_ = 1.0;
+        COST_EXPONENT_ = 1.0;
+
+        nh_.getParam("CONNECTIVITY", CONNECTIVITY_);
+        nh_.getParam("COST_TYPE", COST_TYPE_);
+        nh_.getParam("PLANNING_TIME", PLANNING_TIME_);
+        nh_.getParam("TILED_GRID_ON", TILED_GRID_ON_);
+        nh_.getParam("MAX_GOALS", MAX_GOALS_);
+        nh_.getParam("GOAL_TIMEOUT", GOAL_TIMEOUT_);
+        nh_.getParam("LETHAL_COST", LETHAL_COST_);
+        nh_.getParam("COST_SCALE", COST_SCALE_);
+        nh_.getParam("COST_EXPONENT", COST_EXPONENT_);
+
+        if (!trees_.setPlanner(CONNECTIVITY_, COST_TYPE_))
+                ROS_WARN("CONNECTIVITY %d with COST_TYPE %s not supported, using 8 and double",
+                         CONNECTIVITY_, COST_TYPE_.c_str());
+        trees_.setTiled(TILED_GRID_ON_);
+        trees_.setMaxGoals(MAX_GOALS_ > 0 ? MAX_GOALS_ : 1);
+        double cost_table[256];
+        CostmapIngest::costCurve(cost_table, LETHAL_COST_, COST_SCALE_, COST_EXPONENT_);
+        trees_.setCostTable(cost_table);
+
+        ros::NodeHandle nh;
+        sub_costmap_ = nh.subscribe("costmap", 1, &DstarServer::callbackCostmap, this);
+        sub_costmap_updates_ = nh.subscribe("costmap_updates", 10, &DstarServer::callbackCostmapUpdates, this);
+        srv_plan_ = nh_.advertiseService("make_plan", &DstarServer::callbackPlan, this);
+
+        ROS_INFO("D* Lite server waiting for the costmap on %s", sub_costmap_.getTopic().c_str());
+}
+
+/// ==================================================================================
+/// callbackCostmap(const nav_msgs::OccupancyGrid::ConstPtr& msg)
+/// the whole costmap was published
+/// ==================================================================================
+
+void DstarServer::callbackCostmap(const nav_msgs::OccupancyGrid::ConstPtr& msg){
+
+        info_ = msg->info;
+        frame_ = msg->header.frame_id;
+
+        patch_.resize(msg->data.size());
+        for (size_t i = 0; i < msg->data.size(); i++)
+                patch_[i] = charCost(msg->data[i]);
+
+        if ((int)info_.width != trees_.width() || (int)info_.height != trees_.height())
+                ROS_INFO("D* Lite server costmap %u x %u, goals dropped", info_.width, info_.height);
+        trees_.setMap(patch_.empty() ? NULL : &patch_[0], info_.width, info_.height);
+        repairTrees();
+}
+
+/// ==================================================================================
+/// callbackCostmapUpdates(const map_msgs::OccupancyGridUpdate::ConstPtr& msg)
+/// a rectangle of the costmap was published
+/// ==================================================================================
+
+void DstarServer::callbackCostmapUpdates(const map_msgs::OccupancyGridUpdate::ConstPtr& msg){
+
+        if (trees_.width() == 0)
+                return;
+
+        patch_.resize(msg->data.size());
+        for (size_t i = 0; i < msg->data.size(); i++)
+                patch_[i] = charCost(msg->data[i]);
+
+        if (patch_.size() < (size_t)msg->width*msg->height)
+                return;
+        trees_.updateMap(&patch_[0], msg->x, msg->y, msg->width, msg->height);
+        repairTrees();
+}
+
+/// ==================================================================================
+/// repairTrees()
+/// method to repair the tree of every goal after a costmap change, and to
+/// drop the goals no longer queried
+/// ==================================================================================
+
+void DstarServer::repairTrees(){
+
+        size_t dropped = trees_.dropIdle(GOAL_TIMEOUT_);
+        if (dropped > 0)
+                ROS_DEBUG("D* Lite server dropped %lu idle goals", (unsigned long)dropped);
+
+        ros::WallTime begin = ros::WallTime::now();
+        int n = trees_.repair(PLANNING_TIME_);
+        ROS_DEBUG("D* Lite server repaired %d trees in %f s", n, (ros::WallTime::now() - begin).toSec());
+}
+
+/// ==================================================================================
+/// callbackPlan(nav_msgs::GetPlan::Request &req, nav_msgs::GetPlan::Response &res)
+/// path from req.start to req.goal, in the frame of the costmap
+/// ==================================================================================
+
+bool DstarServer::callbackPlan(nav_msgs::GetPlan::Request &req, nav_msgs::GetPlan::Response &res){
+
+        res.plan.header.stamp = ros::Time::now();
+        res.plan.header.frame_id = frame_;
+
+        if (trees_.width() == 0) {
+                ROS_WARN("D* Lite server has no costmap yet");
+                return false;
+        }
+        if ((!req.start.header.frame_id.empty() && req.start.header.frame_id != frame_) ||
+            (!req.goal.header.frame_id.empty() && req.goal.header.frame_id != frame_)) {
+                ROS_WARN("D* Lite server plans in %s, not in %s / %s", frame_.c_str(),
+                         req.start.header.frame_id.c_str(), req.goal.header.frame_id.c_str());
+                return false;
+        }
+
+        int start_mx, start_my, goal_mx, goal_my;
+        if (!worldToMap(req.start.pose.position.x, req.start.pose.position.y, start_mx, start_my) ||
+            !worldToMap(req.goal.pose.position.x, req.goal.pose.position.y, goal_mx, goal_my)) {
+                ROS_WARN("D* Lite server start or goal outside of the costmap");
+                return true;
+        }
+
+        std::vector<Node> path;
+        ros::WallTime begin = ros::WallTime::now();
+        PlanStatus status = trees_.plan(start_mx, start_my, goal_mx, goal_my, PLANNING_TIME_, path);
+        ROS_DEBUG("D* Lite server plan %d %d to %d %d: status %d, %lu cells in %f s, %lu goals",
+                  start_mx, start_my, goal_mx, goal_my, status, (unsigned long)path.size(),
+                  (ros::WallTime::now() - begin).toSec(), (unsigned long)trees_.size());
+        if (status != PLAN_FOUND)
+                return true;
+
+        /// cell centres, each pose heading for the next one, the last one
+        /// being the goal itself
+        double resolution = info_.resolution;
+        res.plan.poses.resize(path.size());
+        for (size_t i = 0; i < path.size(); i++) {
+                geometry_msgs::PoseStamped &pose = res.plan.poses[i];
+                pose.header = res.plan.header;
+                pose.pose.position.x = info_.origin.position.x + (path[i].x + 0.5)*resolution;
+                pose.pose.position.y = info_.origin.position.y + (path[i].y + 0.5)*resolution;
+                if (i + 1 < path.size())
+                        pose.pose.orientation = tf::createQuaternionMsgFromYaw(
+                                atan2(path[i+1].y - path[i].y, path[i+1].x - path[i].x));
+        }
+        res.plan.poses.back().pose = req.goal.pose;
+        return true;
+}
+
+bool DstarServer::worldToMap(double wx, double wy, int &mx, int &my){
+
+        mx = (int)floor((wx - info_.origin.position.x) / info_.resolution);
+        my = (int)floor((wy - info_.origin.position.y) / info_.resolution);
+        return (mx >= 0) && (my >= 0) && (mx < (int)info_.width) && (my < (int)info_.height);
+}
+
+int main(int argc, char **argv) {
+
+        ros::init(argc, argv, "dstar_server");
+        DstarServer server;
+        ros::spin();
+        return 0;
+}
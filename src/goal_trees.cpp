@@ -0,0 +1,245 @@
+/**
+ * @Filename: goal_trees.cpp
+ * D* Lite search trees shared by all the robots heading to the same goal,
+ * for the planning server (dstar_server).
+ * You may use, distribute and modify this code under the
+ * terms of the BSD license.
+ */
+
+#include "Dstar_lite_planning/goal_trees.h"
+#include <string.h>
+#include <algorithm>
+
+GoalTrees::GoalTrees() {
+
+        width_ = height_ = 0;
+        connectivity_ = 8;
+        costType_ = "double";
+        tiled_ = false;
+        maxGoals_ = 8;
+        CostmapIngest::costCurve(table_, COST_POSSIBLY_CIRCUMSCRIBED, 1, 1);
+}
+
+GoalTrees::~GoalTrees() {
+        clear();
+}
+
+bool GoalTrees::setPlanner(int connectivity, const std::string &costType) {
+
+        DstarBase *d = makeDstar(connectivity, costType);
+        if (d == NULL) return false;
+        delete d;
+
+        clear();
+        connectivity_ = connectivity;
+        costType_ = costType;
+        return true;
+}
+
+void GoalTrees::setTiled(bool tiled) {
+
+        clear();
+        tiled_ = tiled;
+}
+
+void GoalTrees::setCostTable(const double *table) {
+
+        memcpy(table_, table, sizeof(table_));
+        for (size_t i = 0; i < trees_.size(); i++) {
+                trees_[i]->ingest.setCostTable(table_);
+                trees_[i]->ingest.reset();
+        }
+        touchAll();
+}
+
+void GoalTrees::setMaxGoals(size_t n) {
+
+        maxGoals_ = (n > 0) ? n : 1;
+        while (trees_.size() > maxGoals_) dropOldest();
+}
+
+void GoalTrees::setMap(const unsigned char *grid, int width, int height) {
+
+        if (width <= 0 || height <= 0) width = height = 0;
+        if (width != width_ || height != height_) clear();
+
+        width_ = width;
+        height_ = height;
+        grid_.assign(grid, grid + (size_t)width*height);
+        touchAll();
+}
+
+/* void GoalTrees::updateMap(const unsigned char *patch, int x0, int y0, int w, int h)
+ * --------------------------
+ * The rectangle is added to the changed cells of every tree: their next
+ * ingest compares the bounding box of all the rectangles since the last
+ * one, like the bounds of a costmap update.
+ */
+void GoalTrees::updateMap(const unsigned char *patch, int x0, int y0, int w, int h) {
+
+        int xa = std::max(x0, 0), xb = std::min(x0 + w, width_);
+        int ya = std::max(y0, 0), yb = std::min(y0 + h, height_);
+        if (xa >= xb || ya >= yb) return;
+
+        for (int y = ya; y < yb; y++) {
+                memcpy(&grid_[(size_t)y*width_ + xa], patch + (size_t)(y - y0)*w + (xa - x0), xb - xa);
+        }
+
+        for (size_t i = 0; i < trees_.size(); i++) {
+                Tree &t = *trees_[i];
+                if (t.x0 >= t.x1) {
+                        t.x0 = xa; t.y0 = ya;
+                        t.x1 = xb; t.y1 = yb;
+                } else {
+                        t.x0 = std::min(t.x0, xa); t.y0 = std::min(t.y0, ya);
+                        t.x1 = std::max(t.x1, xb); t.y1 = std::max(t.y1, yb);
+                }
+        }
+}
+
+/* PlanStatus GoalTrees::plan(int startX, int startY, int goalX, int goalY, double budget, std::vector<Node> &path)
+ * --------------------------
+ * Same steps as SrlDstarLite::plan on the tree of goal: the former start
+ * cell, whose cost the planner ignored, is sent again with the changed
+ * cells, then the replan.
+ */
+PlanStatus GoalTrees::plan(int startX, int startY, int goalX, int goalY, double budget, std::vector<Node> &path) {
+
+        path.clear();
+        if (!inMap(startX, startY) || !inMap(goalX, goalY)) return PLAN_NO_PATH;
+
+        Tree &t = *tree(startX, startY, goalX, goalY);
+        t.used = Clock::now();
+
+        if (startX != t.startX || startY != t.startY) {
+                t.ingest.touch(t.startX, t.startY);
+                t.startX = startX;
+                t.startY = startY;
+        }
+        t.planner->updateStart(startX, startY);
+        ingest(t);
+
+        PlanStatus status = replan(t, budget);
+        if (status == PLAN_FOUND) path = t.planner->pathCells();
+        return status;
+}
+
+int GoalTrees::repair(double budget) {
+
+        int n = 0;
+        for (size_t i = 0; i < trees_.size(); i++) {
+                Tree &t = *trees_[i];
+                if (t.x0 >= t.x1) continue;
+                ingest(t);
+                replan(t, budget);
+                n++;
+        }
+        return n;
+}
+
+size_t GoalTrees::dropIdle(double idle) {
+
+        Clock::time_point limit = Clock::now() -
+                std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(idle));
+        size_t n = 0;
+        for (size_t i = trees_.size(); i-- > 0;) {
+                if (trees_[i]->used < limit) {
+                        drop(i);
+                        n++;
+                }
+        }
+        return n;
+}
+
+size_t GoalTrees::size() const {
+        return trees_.size();
+}
+
+int GoalTrees::width() const {
+        return width_;
+}
+
+int GoalTrees::height() const {
+        return height_;
+}
+
+/* Tree *GoalTrees::tree(int startX, int startY, int goalX, int goalY)
+ * --------------------------
+ * The tree of goal. A new one starts with the whole map to send and
+ * takes the place of the least recently queried tree once there are
+ * maxGoals_ of them. There are only a handful of goals, a linear search
+ * will do.
+ */
+GoalTrees::Tree *GoalTrees::tree(int startX, int startY, int goalX, int goalY) {
+
+        for (size_t i = 0; i < trees_.size(); i++) {
+                if (trees_[i]->goalX == goalX && trees_[i]->goalY == goalY) return trees_[i];
+        }
+
+        if (trees_.size() >= maxGoals_) dropOldest();
+
+        Tree *t = new Tree;
+        t->planner = makeDstar(connectivity_, costType_);
+        t->planner->setTiled(tiled_);
+        t->planner->setGridSize(width_, height_);
+        t->planner->init(startX, startY, goalX, goalY);
+        t->ingest.setCostTable(table_);
+        t->goalX = goalX;
+        t->goalY = goalY;
+        t->startX = startX;
+        t->startY = startY;
+        t->x0 = t->y0 = 0;
+        t->x1 = width_;
+        t->y1 = height_;
+        t->used = Clock::now();
+        trees_.push_back(t);
+        return t;
+}
+
+void GoalTrees::drop(size_t i) {
+
+        delete trees_[i]->planner;
+        delete trees_[i];
+        trees_.erase(trees_.begin() + i);
+}
+
+void GoalTrees::dropOldest() {
+
+        size_t oldest = 0;
+        for (size_t i = 1; i < trees_.size(); i++) {
+                if (trees_[i]->used < trees_[oldest]->used) oldest = i;
+        }
+        drop(oldest);
+}
+
+void GoalTrees::clear() {
+
+        while (!trees_.empty()) drop(trees_.size() - 1);
+}
+
+void GoalTrees::touchAll() {
+
+        for (size_t i = 0; i < trees_.size(); i++) {
+                trees_[i]->x0 = trees_[i]->y0 = 0;
+                trees_[i]->x1 = width_;
+                trees_[i]->y1 = height_;
+        }
+}
+
+void GoalTrees::ingest(Tree &t) {
+
+        int w = std::max(t.x1 - t.x0, 0);
+        int h = std::max(t.y1 - t.y0, 0);
+        t.ingest.ingestRect(&grid_[0], width_, height_, t.x0, t.y0, w, h, t.planner);
+        t.x0 = t.x1 = 0;
+}
+
+PlanStatus GoalTrees::replan(Tree &t, double budget) {
+
+        if (budget > 0) return t.planner->replanFor(budget);
+        return t.planner->replan() ? PLAN_FOUND : PLAN_NO_PATH;
+}
+
+bool GoalTrees::inMap(int x, int y) const {
+        return (x >= 0) && (y >= 0) && (x < width_) && (y < height_);
+}
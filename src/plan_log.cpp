@@ -0,0 +1,232 @@
+/**
+ * @Filename: plan_log.cpp
+ * Binary log of the inputs given to the D* Lite planner by the plugin,
+ * replayed offline by dstar_replay.
+ * You may use, distribute and modify this code under the
+ * terms of the BSD license.
+ */
+
+#include "Dstar_lite_planning/plan_log.h"
+#include <string.h>
+
+static const char PLAN_LOG_MAGIC[8] = {'D', 'S', 'T', 'A', 'R', 'L', 'O', 'G'};
+
+template <class T>
+static void put(FILE *f, T v) {
+        fwrite(&v, sizeof(T), 1, f);
+}
+
+template <class T>
+static bool get(FILE *f, T &v) {
+        return fread(&v, sizeof(T), 1, f) == 1;
+}
+
+PlanLogConfig::PlanLogConfig() {
+
+        connectivity = 8;
+        costType = "double";
+        dense = true;
+        tiled = false;
+        anytime = false;
+        epsilonStart = 2.5;
+        epsilonStep = 0.5;
+        planningTime = 0;
+        scratchFraction = 0;
+        costLethal = 128;
+        costScale = 1;
+        costExponent = 1;
+}
+
+PlanRecorder::PlanRecorder() {
+
+        file_ = NULL;
+        inPlan_ = false;
+}
+
+PlanRecorder::~PlanRecorder() {
+        close();
+}
+
+bool PlanRecorder::open(const std::string &file, const PlanLogConfig &config) {
+
+        close();
+        file_ = fopen(file.c_str(), "wb");
+        if (file_ == NULL) return false;
+
+        fwrite(PLAN_LOG_MAGIC, 1, sizeof(PLAN_LOG_MAGIC), file_);
+        put<uint32_t>(file_, PLAN_LOG_VERSION);
+
+        put<char>(file_, 'C');
+        put<uint8_t>(file_, config.connectivity);
+        put<uint8_t>(file_, config.costType.size());
+        fwrite(config.costType.data(), 1, config.costType.size(), file_);
+        put<uint8_t>(file_, config.dense);
+        put<uint8_t>(file_, config.tiled);
+        put<uint8_t>(file_, config.anytime);
+        put<double>(file_, config.epsilonStart);
+        put<double>(file_, config.epsilonStep);
+        put<double>(file_, config.planningTime);
+        put<double>(file_, config.scratchFraction);
+        put<int32_t>(file_, config.costLethal);
+        put<double>(file_, config.costScale);
+        put<double>(file_, config.costExponent);
+        fflush(file_);
+        return true;
+}
+
+void PlanRecorder::close() {
+
+        if (file_ == NULL) return;
+        fclose(file_);
+        file_ = NULL;
+        inPlan_ = false;
+}
+
+bool PlanRecorder::isOpen() const {
+        return file_ != NULL;
+}
+
+void PlanRecorder::beginPlan(int width, int height, int startX, int startY, int goalX, int goalY) {
+
+        if (file_ == NULL) return;
+        record_.width = width;
+        record_.height = height;
+        record_.startX = startX;
+        record_.startY = startY;
+        record_.goalX = goalX;
+        record_.goalY = goalY;
+        inPlan_ = true;
+}
+
+/* void PlanRecorder::cell(int index, unsigned char cost)
+ * --------------------------
+ * Cells sent between two plans, e.g. by the costmap update callbacks,
+ * go to the record of the next plan.
+ */
+void PlanRecorder::cell(int index, unsigned char cost) {
+
+        if (file_ == NULL) return;
+        PlanLogCell c;
+        c.index = index;
+        c.cost = cost;
+        record_.cells.push_back(c);
+}
+
+/* void PlanRecorder::endPlan(int status, unsigned long pathLength)
+ * --------------------------
+ * The record goes out in one go and is flushed, a crash of the planner
+ * loses at most the plan being made.
+ */
+void PlanRecorder::endPlan(int status, unsigned long pathLength) {
+
+        if (!inPlan_) return;
+        inPlan_ = false;
+
+        put<char>(file_, 'P');
+        put<int32_t>(file_, record_.width);
+        put<int32_t>(file_, record_.height);
+        put<int32_t>(file_, record_.startX);
+        put<int32_t>(file_, record_.startY);
+        put<int32_t>(file_, record_.goalX);
+        put<int32_t>(file_, record_.goalY);
+        put<uint32_t>(file_, record_.cells.size());
+        for (size_t i = 0; i < record_.cells.size(); i++) {
+                put<uint32_t>(file_, record_.cells[i].index);
+                put<uint8_t>(file_, record_.cells[i].cost);
+        }
+        put<uint8_t>(file_, status);
+        put<uint32_t>(file_, pathLength);
+        fflush(file_);
+        record_.cells.clear();
+}
+
+PlanLogReader::PlanLogReader() {
+
+        file_ = NULL;
+        first_ = 0;
+}
+
+PlanLogReader::~PlanLogReader() {
+        close();
+}
+
+bool PlanLogReader::open(const std::string &file, PlanLogConfig &config) {
+
+        close();
+        file_ = fopen(file.c_str(), "rb");
+        if (file_ == NULL) return false;
+
+        char magic[sizeof(PLAN_LOG_MAGIC)];
+        uint32_t version;
+        char type;
+        uint8_t connectivity, length, dense, tiled, anytime;
+        int32_t lethal;
+        if (fread(magic, 1, sizeof(magic), file_) != sizeof(magic) ||
+            memcmp(magic, PLAN_LOG_MAGIC, sizeof(magic)) != 0 ||
+            !get(file_, version) || version != PLAN_LOG_VERSION ||
+            !get(file_, type) || type != 'C' ||
+            !get(file_, connectivity) || !get(file_, length)) {
+                close();
+                return false;
+        }
+
+        std::vector<char> costType(length);
+        if ((length > 0 && fread(&costType[0], 1, length, file_) != length) ||
+            !get(file_, dense) || !get(file_, tiled) || !get(file_, anytime) ||
+            !get(file_, config.epsilonStart) || !get(file_, config.epsilonStep) ||
+            !get(file_, config.planningTime) || !get(file_, config.scratchFraction) ||
+            !get(file_, lethal) || !get(file_, config.costScale) || !get(file_, config.costExponent)) {
+                close();
+                return false;
+        }
+        config.connectivity = connectivity;
+        config.costType.assign(costType.begin(), costType.end());
+        config.dense = dense;
+        config.tiled = tiled;
+        config.anytime = anytime;
+        config.costLethal = lethal;
+
+        first_ = ftell(file_);
+        return true;
+}
+
+void PlanLogReader::close() {
+
+        if (file_ == NULL) return;
+        fclose(file_);
+        file_ = NULL;
+}
+
+void PlanLogReader::rewind() {
+
+        if (file_ != NULL) fseek(file_, first_, SEEK_SET);
+}
+
+bool PlanLogReader::next(PlanLogRecord &record) {
+
+        if (file_ == NULL) return false;
+
+        char type;
+        int32_t v[6];
+        uint32_t n;
+        if (!get(file_, type) || type != 'P' ||
+            fread(v, sizeof(int32_t), 6, file_) != 6 || !get(file_, n)) return false;
+
+        record.width = v[0];
+        record.height = v[1];
+        record.startX = v[2];
+        record.startY = v[3];
+        record.goalX = v[4];
+        record.goalY = v[5];
+        record.cells.resize(n);
+        for (uint32_t i = 0; i < n; i++) {
+                if (!get(file_, record.cells[i].index) || !get(file_, record.cells[i].cost)) return false;
+        }
+
+        uint8_t status;
+        uint32_t pathLength;
+        if (!get(file_, status) || !get(file_, pathLength)) return false;
+        record.status = status;
+        record.pathLength = pathLength;
+        return true;
+}
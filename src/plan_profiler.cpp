@@ -0,0 +1,209 @@
+/**
+ * @Filename: plan_profiler.cpp
+ * Phase latencies of the planning cycle: rolling histograms and an
+ * optional Chrome trace-event dump.
+ * You may use, distribute and modify this code under the
+ * terms of the BSD license.
+ */
+
+#include "Dstar_lite_planning/plan_profiler.h"
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+RollingHistogram::RollingHistogram(size_t window) {
+
+        window_ = (window > 0) ? window : 1;
+        clear();
+}
+
+void RollingHistogram::clear() {
+
+        samples_.clear();
+        next_ = 0;
+        total_ = 0;
+        last_ = 0;
+}
+
+/* void RollingHistogram::add(double v)
+ * --------------------------
+ * Adds a sample, replacing the oldest one once the window is full.
+ */
+void RollingHistogram::add(double v) {
+
+        if (samples_.size() < window_) samples_.push_back(v);
+        else samples_[next_] = v;
+        next_ = (next_ + 1) % window_;
+        total_++;
+        last_ = v;
+}
+
+size_t RollingHistogram::count() const {
+        return samples_.size();
+}
+
+unsigned long RollingHistogram::total() const {
+        return total_;
+}
+
+double RollingHistogram::percentile(double p) const {
+
+        if (samples_.empty()) return 0;
+
+        std::vector<double> sorted(samples_);
+        size_t n = sorted.size();
+        size_t rank = (p <= 0) ? 0 : (size_t)(p*n + 0.999999);
+        if (rank > 0) rank--;
+        if (rank >= n) rank = n - 1;
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        return sorted[rank];
+}
+
+double RollingHistogram::last() const {
+        return last_;
+}
+
+double RollingHistogram::max() const {
+
+        if (samples_.empty()) return 0;
+        return *std::max_element(samples_.begin(), samples_.end());
+}
+
+double RollingHistogram::mean() const {
+
+        if (samples_.empty()) return 0;
+        double sum = 0;
+        for (size_t i = 0; i < samples_.size(); i++) sum += samples_[i];
+        return sum/samples_.size();
+}
+
+PlanProfiler::PlanProfiler(size_t window) {
+
+        window_ = window;
+        inCycle_ = false;
+        current_ = -1;
+        trace_ = NULL;
+        traceEmpty_ = true;
+        epoch_ = Clock::now();
+        names_.push_back("cycle");
+        histograms_.push_back(RollingHistogram(window_));
+}
+
+PlanProfiler::~PlanProfiler() {
+        closeTrace();
+}
+
+void PlanProfiler::setWindow(size_t window) {
+
+        window_ = window;
+        for (size_t i = 0; i < histograms_.size(); i++) {
+                histograms_[i] = RollingHistogram(window_);
+        }
+}
+
+/* void PlanProfiler::beginCycle()
+ * --------------------------
+ * Starts a cycle, ending the previous one if it was left open.
+ */
+void PlanProfiler::beginCycle() {
+
+        if (inCycle_) endCycle();
+        inCycle_ = true;
+        current_ = -1;
+        cycleBegin_ = Clock::now();
+}
+
+/* void PlanProfiler::phase(const char *name)
+ * --------------------------
+ * Ends the running phase and starts the phase name. Outside of a cycle
+ * nothing is timed.
+ */
+void PlanProfiler::phase(const char *name) {
+
+        if (!inCycle_) return;
+
+        Clock::time_point now = Clock::now();
+        closePhase(now);
+        current_ = (int)indexOf(name);
+        phaseBegin_ = now;
+}
+
+void PlanProfiler::endCycle() {
+
+        if (!inCycle_) return;
+
+        Clock::time_point now = Clock::now();
+        closePhase(now);
+        record(0, cycleBegin_, now);
+        inCycle_ = false;
+        if (trace_ != NULL) fflush(trace_);
+}
+
+void PlanProfiler::closePhase(Clock::time_point now) {
+
+        if (current_ >= 0) record(current_, phaseBegin_, now);
+        current_ = -1;
+}
+
+/* size_t PlanProfiler::indexOf(const char *name)
+ * --------------------------
+ * Histogram of the phase name, created the first time the phase is
+ * seen. There are only a handful of phases, a linear search will do.
+ */
+size_t PlanProfiler::indexOf(const char *name) {
+
+        for (size_t i = 1; i < names_.size(); i++) {
+                if (strcmp(names_[i].c_str(), name) == 0) return i;
+        }
+        names_.push_back(name);
+        histograms_.push_back(RollingHistogram(window_));
+        return names_.size() - 1;
+}
+
+/* void PlanProfiler::record(size_t i, Clock::time_point begin, Clock::time_point end)
+ * --------------------------
+ * Adds the duration to the histogram of phase i and, if a trace is open,
+ * writes the phase as a complete ("X") event, times in microseconds.
+ */
+void PlanProfiler::record(size_t i, Clock::time_point begin, Clock::time_point end) {
+
+        histograms_[i].add(std::chrono::duration<double>(end - begin).count());
+
+        if (trace_ == NULL) return;
+
+        double ts  = std::chrono::duration<double, std::micro>(begin - epoch_).count();
+        double dur = std::chrono::duration<double, std::micro>(end - begin).count();
+        fprintf(trace_, "%s{\"name\":\"%s\",\"cat\":\"dstar\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d}",
+                traceEmpty_ ? "\n" : ",\n", names_[i].c_str(), ts, dur, (int)getpid(), (i == 0) ? 0 : 1);
+        traceEmpty_ = false;
+}
+
+bool PlanProfiler::openTrace(const std::string &file) {
+
+        closeTrace();
+        trace_ = fopen(file.c_str(), "w");
+        if (trace_ == NULL) return false;
+        fputc('[', trace_);
+        traceEmpty_ = true;
+        return true;
+}
+
+void PlanProfiler::closeTrace() {
+
+        if (trace_ == NULL) return;
+        fputs("\n]\n", trace_);
+        fclose(trace_);
+        trace_ = NULL;
+}
+
+size_t PlanProfiler::phases() const {
+        return names_.size();
+}
+
+const std::string &PlanProfiler::phaseName(size_t i) const {
+        return names_[i];
+}
+
+const RollingHistogram &PlanProfiler::histogram(size_t i) const {
+        return histograms_[i];
+}
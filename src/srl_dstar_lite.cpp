@@ -26,6 +26,10 @@ using namespace base_local_planner;
 //extern Config config;
 tf::TransformListener* listener;
 
+// seconds without makePlan after which the planner thread stops repairing
+// the plan of the last goal
+#define ASYNC_IDLE_TIME 2.0
+
 
 namespace srl_dstar_lite {
 
@@ -122,21 +126,33 @@ void SrlDstarLite::setGoal(double x, double y, double theta, double toll, std::s
         /// Apply the proper transform
         tf::Pose result = transform*source;
 
+        geometry_msgs::PoseStamped goal;
+        goal.header.frame_id = costmap_frame_;
+        goal.pose.position.x = result.getOrigin().x();
+        goal.pose.position.y = result.getOrigin().y();
+        goal.pose.position.z = result.getOrigin().z();
+        tf::quaternionTFToMsg(result.getRotation(), goal.pose.orientation);
 
-        this->goal_theta_= tf::getYaw( result.getRotation());
-        this->goal_x_ = result.getOrigin().x();
-        this->goal_y_ = result.getOrigin().y();
-        this->toll_goal_ = toll;
-        this->goal_init_ = true;
+        storeGoal(goal, toll);
+}
 
-        ROS_WARN("GOAL SET!!");
-        ROS_WARN("GOAL SET!!");
-        ROS_WARN("GOAL SET!!");
-        goal_pose_.position.x = result.getOrigin().x();
-        goal_pose_.position.y = result.getOrigin().y();
-        goal_pose_.position.z = result.getOrigin().z();
+/// ==================================================================================
+/// storeGoal(const geometry_msgs::PoseStamped& goal, double toll)
+/// Method to store the Goal region description, the goal being in the costmap frame
+/// ==================================================================================
+void SrlDstarLite::storeGoal(const geometry_msgs::PoseStamped& goal, double toll){
+
+        double theta = tf::getYaw(goal.pose.orientation);
+        /// called by every plan, only a new goal is logged
+        if (!goal_init_ || goal.pose.position.x != goal_x_ || goal.pose.position.y != goal_y_ || theta != goal_theta_)
+                ROS_DEBUG("D* Lite goal set to %f %f %f", goal.pose.position.x, goal.pose.position.y, theta);
 
-        tf::quaternionTFToMsg(result.getRotation(), goal_pose_.orientation);
+        this->goal_theta_= theta;
+        this->goal_x_ = goal.pose.position.x;
+        this->goal_y_ = goal.pose.position.y;
+        this->toll_goal_ = toll;
+
+        goal_pose_ = goal.pose;
 
         this->goal_init_=true;
 
@@ -201,6 +217,330 @@ void SrlDstarLite::publishPath(std::vector< geometry_msgs::PoseStamped > grid_pl
         }
 }
 
+/// ==================================================================================
+/// callbackObstacles(const nav_msgs::OccupancyGrid::ConstPtr& msg)
+/// the whole costmap was published
+/// ==================================================================================
+
+void SrlDstarLite::callbackObstacles(const nav_msgs::OccupancyGrid::ConstPtr& msg){
+
+        if (COSTMAP_EVENTS_ON_)
+                ingestPatch(0, 0, msg->info.width, msg->info.height);
+        else
+                markPatch(0, 0, msg->info.width, msg->info.height);
+}
+
+/// ==================================================================================
+/// callbackObstacleUpdates(const map_msgs::OccupancyGridUpdate::ConstPtr& msg)
+/// a rectangle of the costmap was published
+/// ==================================================================================
+
+void SrlDstarLite::callbackObstacleUpdates(const map_msgs::OccupancyGridUpdate::ConstPtr& msg){
+
+        if (COSTMAP_EVENTS_ON_)
+                ingestPatch(msg->x, msg->y, msg->width, msg->height);
+        else
+                markPatch(msg->x, msg->y, msg->width, msg->height);
+}
+
+/// ==================================================================================
+/// ingestPatch(int x, int y, int width, int height)
+/// method to send the changed costs of a rectangle of the costmap to the planner.
+/// The messages only tell which cells changed, the costs are read from the
+/// costmap itself, in the full char range the plan() sweep uses. Runs on the
+/// thread of costmap_queue_, so that waiting here for a plan to end stalls
+/// no other callback of move_base
+/// ==================================================================================
+
+void SrlDstarLite::ingestPatch(int x, int y, int width, int height){
+
+        /// both or none: the planner thread holds the planner without the
+        /// costmap during its replan, waiting for it with the costmap would
+        /// hold up the costmap updates
+        boost::unique_lock<costmap_2d::Costmap2D::mutex_t> costmap_lock(*(costmap_->getMutex()), boost::defer_lock);
+        boost::unique_lock<boost::mutex> lock(planner_mutex_, boost::defer_lock);
+        boost::lock(costmap_lock, lock);
+
+        int nx_cells = costmap_->getSizeInCellsX();
+        int ny_cells = costmap_->getSizeInCellsY();
+
+        /// the planner storage is sized by the next plan
+        if (DENSE_GRID_ON_ && (dstar_planner_->getGridWidth() != nx_cells || dstar_planner_->getGridHeight() != ny_cells))
+                return;
+
+        int n_changed = costmap_ingest_.ingestRect(costmap_->getCharMap(), nx_cells, ny_cells,
+                                                   x, y, width, height, dstar_planner_);
+        costmap_events_ = true;
+        if (n_changed > 0)
+                map_version_++;
+        ROS_DEBUG("Costmap update %d %d %d x %d, %d changed cells", x, y, width, height, n_changed);
+}
+
+/// ==================================================================================
+/// markPatch(int x, int y, int width, int height)
+/// method to add a published rectangle of the costmap to the cells the next
+/// ROI_RADIUS plan compares. The costmap publisher covers every update since
+/// its last message, so that their union spans all the changes since the
+/// last plan, not only those of the last costmap cycle
+/// ==================================================================================
+
+void SrlDstarLite::markPatch(int x, int y, int width, int height){
+
+        if (width <= 0 || height <= 0)
+                return;
+        boost::mutex::scoped_lock lock(roi_mutex_);
+        if (roi_x1_ <= roi_x0_) {
+                roi_x0_ = x;
+                roi_y0_ = y;
+                roi_x1_ = x + width;
+                roi_y1_ = y + height;
+        }
+        else {
+                roi_x0_ = std::min(roi_x0_, x);
+                roi_y0_ = std::min(roi_y0_, y);
+                roi_x1_ = std::max(roi_x1_, x + width);
+                roi_y1_ = std::max(roi_y1_, y + height);
+        }
+}
+
+/// ==================================================================================
+/// publishStats(PlanStatus status, double plan_time)
+/// method to publish the statistics of the last replan
+/// ==================================================================================
+
+void SrlDstarLite::publishStats(PlanStatus status, double plan_time){
+
+        SearchStats st = dstar_planner_->getStats();
+
+        Dstar_lite_planning::PlannerStats msg;
+        msg.header.stamp = ros::Time::now();
+        msg.header.frame_id = costmap_frame_;
+        msg.status = status;
+        msg.epsilon = dstar_planner_->getEpsilon();
+        msg.expansions = st.expansions;
+        msg.vertex_updates = st.vertexUpdates;
+        msg.heap_pushes = st.heapPushes;
+        msg.heap_updates = st.heapUpdates;
+        msg.heap_removes = st.heapRemoves;
+        msg.stale_keys = st.staleKeys;
+        msg.cells_created = st.cellsCreated;
+        msg.peak_open_list = st.peakOpenList;
+        msg.cells = st.cells;
+        msg.tiles = st.tiles;
+        msg.search_time = st.searchTime;
+        msg.extract_time = st.extractTime;
+        msg.path_reused = st.pathReused;
+        msg.plan_time = plan_time;
+
+        pub_stats_.publish(msg);
+
+        ROS_DEBUG("D* Lite expanded %lu nodes in %f s, path extracted in %f s",
+                  st.expansions, st.searchTime, st.extractTime);
+}
+
+
+
+/// ==================================================================================
+/// publishCostField(int start_mx, int start_my)
+/// method to publish the cost to goal of the cells within FIELD_RADIUS of
+/// the start, as settled by the last replan
+/// ==================================================================================
+
+void SrlDstarLite::publishCostField(int start_mx, int start_my){
+
+        if (pub_field_.getNumSubscribers() == 0)
+                return;
+
+        double resolution = costmap_->getResolution();
+        int r = (int)ceil(FIELD_RADIUS_ / resolution);
+        int x0 = std::max(0, start_mx - r);
+        int y0 = std::max(0, start_my - r);
+        int xn = std::min((int)costmap_->getSizeInCellsX(), start_mx + r + 1);
+        int yn = std::min((int)costmap_->getSizeInCellsY(), start_my + r + 1);
+
+        dstar_planner_->getCostField(x0, y0, xn - x0, yn - y0, cost_field_);
+
+        Dstar_lite_planning::CostField msg;
+        msg.header.stamp = ros::Time::now();
+        msg.header.frame_id = costmap_frame_;
+        msg.info.map_load_time = msg.header.stamp;
+        msg.info.resolution = resolution;
+        msg.info.width = xn - x0;
+        msg.info.height = yn - y0;
+        msg.info.origin.position.x = costmap_->getOriginX() + x0*resolution;
+        msg.info.origin.position.y = costmap_->getOriginY() + y0*resolution;
+        msg.info.origin.orientation.w = 1.0;
+        msg.goal.x = goal_x_;
+        msg.goal.y = goal_y_;
+
+        /// planner units are lengths of free cells
+        msg.data.resize(cost_field_.size());
+        for (size_t i = 0; i < cost_field_.size(); i++)
+                msg.data[i] = cost_field_[i]*resolution;
+
+        pub_field_.publish(msg);
+}
+
+
+
+/// ==================================================================================
+/// publishDiagnostics()
+/// method to publish the phase latencies of makePlan, at most every
+/// DIAGNOSTICS_PERIOD seconds
+/// ==================================================================================
+
+void SrlDstarLite::publishDiagnostics(){
+
+        ros::WallTime now = ros::WallTime::now();
+        if (DIAGNOSTICS_PERIOD_ < 0 || (now - last_diagnostics_).toSec() < DIAGNOSTICS_PERIOD_)
+                return;
+        last_diagnostics_ = now;
+
+        diagnostic_msgs::DiagnosticStatus status;
+        status.level = diagnostic_msgs::DiagnosticStatus::OK;
+        status.name = node_name_ + ": makePlan latency";
+        status.hardware_id = costmap_frame_;
+
+        /// milliseconds over the last PROFILE_WINDOW cycles
+        for (size_t i = 0; i < profiler_.phases(); i++) {
+                const RollingHistogram &h = profiler_.histogram(i);
+                char value[128];
+                snprintf(value, sizeof(value), "p50 %.3f p90 %.3f p99 %.3f max %.3f ms, %lu calls",
+                         h.percentile(0.5)*1e3, h.percentile(0.9)*1e3, h.percentile(0.99)*1e3,
+                         h.max()*1e3, h.total());
+                diagnostic_msgs::KeyValue kv;
+                kv.key = profiler_.phaseName(i);
+                kv.value = value;
+                status.values.push_back(kv);
+        }
+
+        const RollingHistogram &cycle = profiler_.histogram(0);
+        char message[64];
+        snprintf(message, sizeof(message), "makePlan p99 %.3f ms", cycle.percentile(0.99)*1e3);
+        status.message = message;
+
+        diagnostic_msgs::DiagnosticArray msg;
+        msg.header.stamp = ros::Time::now();
+        msg.status.push_back(status);
+        pub_diagnostics_.publish(msg);
+}
+
+
+
+/// ==================================================================================
+/// planCells(const std::vector< geometry_msgs::PoseStamped > &grid_plan, std::vector<Node> &cells,
+///           std::vector<size_t> &poses)
+/// method to list the costmap cells crossed by a plan, in order, with the
+/// pose each of them leads to
+/// ==================================================================================
+
+void SrlDstarLite::planCells(const std::vector< geometry_msgs::PoseStamped > &grid_plan, std::vector<Node> &cells,
+                             std::vector<size_t> &poses){
+
+        cells.clear();
+        poses.clear();
+        double step = costmap_->getResolution()/2;
+
+        for (size_t i = 0; i < grid_plan.size(); i++) {
+                double x1 = grid_plan[i].pose.position.x;
+                double y1 = grid_plan[i].pose.position.y;
+                double x0 = (i > 0) ? grid_plan[i-1].pose.position.x : x1;
+                double y0 = (i > 0) ? grid_plan[i-1].pose.position.y : y1;
+
+                /// half cell steps along the segment, shortcuts and splines
+                /// leave gaps between the poses
+                int n = (int)ceil(hypot(x1 - x0, y1 - y0)/step);
+                for (int k = (i > 0) ? 1 : 0; k <= n; k++) {
+                        double t = (n > 0) ? (double)k/n : 1;
+                        unsigned int mx, my;
+                        if (!costmap_->worldToMap(x0 + t*(x1 - x0), y0 + t*(y1 - y0), mx, my))
+                                continue;
+                        Node c;
+                        c.x = mx;
+                        c.y = my;
+                        if (cells.empty() || cells.back().x != c.x || cells.back().y != c.y) {
+                                cells.push_back(c);
+                                poses.push_back(i);
+                        }
+                }
+        }
+}
+
+/// ==================================================================================
+/// reusePlan(std::vector< geometry_msgs::PoseStamped > &grid_plan, geometry_msgs::PoseStamped& start,
+///           int start_mx, int start_my, int goal_mx, int goal_my)
+/// method to return the last plan without its traversed part, if the goal is
+/// the same, the robot is on the plan and no cell on or next to the rest of
+/// the plan changed
+/// ==================================================================================
+
+bool SrlDstarLite::reusePlan(std::vector< geometry_msgs::PoseStamped > &grid_plan, geometry_msgs::PoseStamped& start,
+                             int start_mx, int start_my, int goal_mx, int goal_my){
+
+        if (!PLAN_REUSE_ON_ || !reuse_valid_ || costmap_ingest_.reloaded())
+                return false;
+        if (goal_mx != reuse_goal_mx_ || goal_my != reuse_goal_my_)
+                return false;
+        /// an Anytime D* plan still to be improved
+        if (ANYTIME_ON_ && dstar_planner_->getEpsilon() > 1)
+                return false;
+
+        /// the robot has to be on a cell of the plan or next to it. The
+        /// first such cell is taken, the plan starting where the last one
+        /// was cut: a later pass of the plan near the robot (a U-turn, a
+        /// loop around an obstacle) is still ahead of it, and the cells up
+        /// to it are checked for changes
+        int from = -1;
+        for (size_t i = 0; i < reuse_path_.size(); i++) {
+                if (abs(reuse_path_[i].x - start_mx) <= 1 && abs(reuse_path_[i].y - start_my) <= 1) {
+                        from = i;
+                        break;
+                }
+        }
+        if (from < 0)
+                return false;
+
+        const std::vector<int> &changes = costmap_ingest_.changes();
+        if (!changes.empty()) {
+                int nx_cells = costmap_->getSizeInCellsX();
+                int ny_cells = costmap_->getSizeInCellsY();
+                std::unordered_set<int> near;
+                for (size_t i = from; i < reuse_path_.size(); i++) {
+                        /// the neighbours off the map are no cells
+                        const Node &c = reuse_path_[i];
+                        for (int y = std::max(c.y - 1, 0); y <= std::min(c.y + 1, ny_cells - 1); y++) {
+                                for (int x = std::max(c.x - 1, 0); x <= std::min(c.x + 1, nx_cells - 1); x++) {
+                                        near.insert(y*nx_cells + x);
+                                }
+                        }
+                }
+                for (size_t i = 0; i < changes.size(); i++) {
+                        if (near.count(changes[i]))
+                                return false;
+                }
+        }
+
+        /// the poses before the one closest to the robot are dropped. The
+        /// search goes forward from the pose the robot cell leads to, a part
+        /// of the plan passing near the robot again later stays
+        size_t closest = std::max(reuse_pose_[from], (size_t)1);
+        while (closest + 1 < reuse_plan_.size() &&
+               hypot(reuse_plan_[closest + 1].pose.position.x - start.pose.position.x,
+                     reuse_plan_[closest + 1].pose.position.y - start.pose.position.y) <=
+               hypot(reuse_plan_[closest].pose.position.x - start.pose.position.x,
+                     reuse_plan_[closest].pose.position.y - start.pose.position.y))
+                closest++;
+
+        grid_plan.clear();
+        grid_plan.push_back(start);
+        grid_plan.insert(grid_plan.end(), reuse_plan_.begin() + std::min(closest, reuse_plan_.size()), reuse_plan_.end());
+
+        /// the next check starts from here
+        reuse_plan_ = grid_plan;
+        planCells(grid_plan, reuse_path_, reuse_pose_);
+        return true;
+}
+
 
 
 /// ==================================================================================
@@ -450,9 +790,13 @@ double SrlDstarLite::getFootPrintCost(double x_bot, double y_bot, double orient_
 /// method to solve a planning probleme.
 /// ==================================================================================
 
-int SrlDstarLite::plan(std::vector< geometry_msgs::PoseStamped > &grid_plan, geometry_msgs::PoseStamped& start){
+int SrlDstarLite::plan(std::vector< geometry_msgs::PoseStamped > &grid_plan, geometry_msgs::PoseStamped& start,
+                       boost::unique_lock<costmap_2d::Costmap2D::mutex_t> &costmap_lock){
         /// TODO plan using the D* Lite Object
 
+        ros::WallTime plan_begin = ros::WallTime::now();
+        profiler_.phase("start_goal");
+
 
         /// 0. Setting Start and Goal points
         /// start
@@ -460,68 +804,152 @@ int SrlDstarLite::plan(std::vector< geometry_msgs::PoseStamped > &grid_plan, geo
         unsigned int start_my;
         double start_x = start.pose.position.x;
         double start_y = start.pose.position.y;
-        costmap_->worldToMap ( start_x, start_y, start_mx, start_my);
-        ROS_DEBUG("Update Start Point %f %f to %d %d", start_x, start_y, start_mx, start_my);
-        dstar_planner_->updateStart(start_mx, start_my);
+        if (!costmap_->worldToMap ( start_x, start_y, start_mx, start_my)) {
+                ROS_WARN("D* Lite start %f %f is outside of the costmap", start_x, start_y);
+                return false;
+        }
         /// goal
         unsigned int goal_mx;
         unsigned int goal_my;
-        costmap_->worldToMap (goal_x_, goal_y_, goal_mx, goal_my);
-        ROS_DEBUG("Update Goal Point %f %f to %d %d", goal_x_, goal_y_, goal_mx, goal_my);
-        dstar_planner_->updateGoal(goal_mx, goal_my);
+        if (!costmap_->worldToMap (goal_x_, goal_y_, goal_mx, goal_my)) {
+                ROS_WARN("D* Lite goal %f %f is outside of the costmap", goal_x_, goal_y_);
+                return false;
+        }
 
-        /// 1.Update Planner costs
         int nx_cells, ny_cells;
         nx_cells = costmap_->getSizeInCellsX();
         ny_cells = costmap_->getSizeInCellsY();
-        ROS_DEBUG("Update cell costs");
-
-
-        unsigned char* grid = costmap_->getCharMap();
-        for(int x=0; x<(int)costmap_->getSizeInCellsX(); x++) {
-                for(int y=0; y<(int)costmap_->getSizeInCellsY(); y++) {
-                        int index = costmap_->getIndex(x,y);
-
-
-                        double c = (double)grid[index];
 
-                        if( c >= COST_POSSIBLY_CIRCUMSCRIBED)
-                                dstar_planner_->updateCell(x, y, -1);
-                        else if (c == costmap_2d::FREE_SPACE) {
-                                dstar_planner_->updateCell(x, y, 1);
-                        }else
-                        {
-                                dstar_planner_->updateCell(x, y, c);
-                        }
+        /// The costmap is a bounded grid, so D* Lite can keep its cells in
+        /// flat arrays instead of the hash map
+        if (DENSE_GRID_ON_) {
+                if (dstar_planner_->getGridWidth() != nx_cells || dstar_planner_->getGridHeight() != ny_cells) {
+                        ROS_INFO("D* Lite %s grid storage %d x %d", TILED_GRID_ON_ ? "tiled" : "dense", nx_cells, ny_cells);
+                        dstar_planner_->setGridSize(nx_cells, ny_cells);
+                        dstar_planner_->init(start_mx, start_my, goal_mx, goal_my);
+                        costmap_ingest_.reset();
                 }
+        } else if (dstar_planner_->getGridWidth() != 0) {
+                dstar_planner_->setGridSize(0, 0);
+                dstar_planner_->init(start_mx, start_my, goal_mx, goal_my);
+                costmap_ingest_.reset();
         }
 
-        // /// Update Cell Costs in the dstar_planner, the cell is updated
-        // /// in the costmap frame
-        // for(int x = 0; x<nx_cells; x++ )
-        //     for(int y = 0; y<ny_cells; y++ ){
-
-
+        recorder_.beginPlan(nx_cells, ny_cells, start_mx, start_my, goal_mx, goal_my);
+        ROS_DEBUG("Update Start Point %f %f to %d %d", start_x, start_y, start_mx, start_my);
+        dstar_planner_->updateStart(start_mx, start_my);
+        ROS_DEBUG("Update Goal Point %f %f to %d %d", goal_x_, goal_y_, goal_mx, goal_my);
+        dstar_planner_->updateGoal(goal_mx, goal_my);
 
-        //         // double c = this->getFootPrintCost(x,y,0);
-        //         double c = costmap_->getCost(x,y);
-        //         if( c >= COST_POSSIBLY_CIRCUMSCRIBED)
-        //             dstar_planner_->updateCell(x, y, -1);
-        //         else if (c == costmap_2d::FREE_SPACE){
-        //             dstar_planner_->updateCell(x, y, 1);
-        //         }else
-        //         {
-        //             dstar_planner_->updateCell(x, y, c);
-        //         }
-        // }
+        /// 1.Update Planner costs
+        /// The planner ignores the costs of the start and goal cells, once
+        /// they moved their real costs have to be sent again
+        if ((int)start_mx != last_start_mx_ || (int)start_my != last_start_my_)
+                costmap_ingest_.touch(last_start_mx_, last_start_my_);
+        if ((int)goal_mx != last_goal_mx_ || (int)goal_my != last_goal_my_)
+                costmap_ingest_.touch(last_goal_mx_, last_goal_my_);
+        last_start_mx_ = start_mx;
+        last_start_my_ = start_my;
+        last_goal_mx_ = goal_mx;
+        last_goal_my_ = goal_my;
+
+        /// Only the cells whose cost changed since the last call are sent
+        profiler_.phase("costmap");
+        ROS_DEBUG("Update cell costs");
+        unsigned char* grid = costmap_->getCharMap();
+        int n_changed;
+        if (COSTMAP_EVENTS_ON_ && costmap_events_)
+                /// the callbacks already sent the changed cells, only the
+                /// former start and goal cells (or a new map) are left
+                n_changed = costmap_ingest_.ingestRect(grid, nx_cells, ny_cells, 0, 0, 0, 0, dstar_planner_);
+        else if (ROI_RADIUS_ > 0 && roi_published_) {
+                /// after the first full load only the window around the
+                /// robot, the updates published since the last plan and the
+                /// bounds of the last costmap update, not published yet,
+                /// are compared, the rest of the map is taken as unchanged
+                int x0_roi, y0_roi, x1_roi, y1_roi;
+                {
+                        boost::mutex::scoped_lock roi_lock(roi_mutex_);
+                        x0_roi = roi_x0_;
+                        y0_roi = roi_y0_;
+                        x1_roi = roi_x1_;
+                        y1_roi = roi_y1_;
+                        roi_x0_ = roi_y0_ = roi_x1_ = roi_y1_ = 0;
+                }
+                int r = (int)ceil(ROI_RADIUS_ / costmap_->getResolution());
+                n_changed = costmap_ingest_.ingestRect(grid, nx_cells, ny_cells,
+                                                       (int)start_mx - r, (int)start_my - r, 2*r + 1, 2*r + 1, dstar_planner_);
+                if (x1_roi > x0_roi && y1_roi > y0_roi)
+                        n_changed += costmap_ingest_.ingestRect(grid, nx_cells, ny_cells,
+                                                                x0_roi, y0_roi, x1_roi - x0_roi, y1_roi - y0_roi, dstar_planner_);
+                unsigned int x0, xn, y0, yn;
+                costmap_ros_->getLayeredCostmap()->getBounds(&x0, &xn, &y0, &yn);
+                if (xn > x0 && yn > y0)
+                        n_changed += costmap_ingest_.ingestRect(grid, nx_cells, ny_cells,
+                                                                x0, y0, xn - x0, yn - y0, dstar_planner_);
+        }
+        else
+                n_changed = costmap_ingest_.ingest(grid, nx_cells, ny_cells, dstar_planner_);
+        ROS_DEBUG("Updated %d changed cells", n_changed);
+        if (n_changed > 0)
+                map_version_++;
+
+        /// nothing changed near the last path: the planner is left alone,
+        /// the changes stay pending in it until the next replan
+        bool reused = reusePlan(grid_plan, start, start_mx, start_my, goal_mx, goal_my);
+        costmap_ingest_.clearChanges();
+
+        /// the planner has its own copy of the costs now, the costmap is let
+        /// go for the replan (move_base still holds it when it called makePlan
+        /// itself). The shortcut reads the costs without it, a cell written
+        /// meanwhile is checked again by the next plan
+        costmap_lock.unlock();
+
+        if (reused) {
+                ROS_DEBUG("D* Lite plan of map version %lu reused", reuse_map_version_);
+                /// the cells sent meanwhile are recorded with the reuse, not
+                /// with the next replan
+                if (recorder_.isOpen())
+                        recorder_.endPlan(PLAN_LOG_REUSED, reuse_path_.size());
+                return true;
+        }
+        reuse_valid_ = false;
 
         ROS_DEBUG("Replan");
         /// dstar_planner_->draw();
         /// 2. Plannig using D* Lite
-        dstar_planner_->replan();
+        /// the time spent on the map update counts against the deadline
+        double budget = PLANNING_TIME_ - (ros::WallTime::now() - plan_begin).toSec();
+        profiler_.phase("replan");
+        PlanStatus status;
+        if (ANYTIME_ON_) {
+                status = dstar_planner_->replanAnytime(budget);
+                ROS_DEBUG("Anytime D* path with epsilon %f", dstar_planner_->getEpsilon());
+        } else if (PLANNING_TIME_ > 0) {
+                status = dstar_planner_->replanFor(budget);
+        } else {
+                status = dstar_planner_->replan() ? PLAN_FOUND : PLAN_NO_PATH;
+        }
+
+        publishStats(status, (ros::WallTime::now() - plan_begin).toSec());
+        if (recorder_.isOpen())
+                recorder_.endPlan(status, dstar_planner_->pathCells().size());
+
+        if (status == PLAN_INCOMPLETE) {
+                /// the search goes on from where it stopped at the next call
+                ROS_INFO("D* Lite search suspended after %f s, resuming at the next plan",
+                         (ros::WallTime::now() - plan_begin).toSec());
+                return false;
+        }
+
+        if (FIELD_RADIUS_ > 0 && status == PLAN_FOUND) {
+                profiler_.phase("cost_field");
+                publishCostField(start_mx, start_my);
+        }
 
         ROS_DEBUG("Get Path");
         /// 3. Get Path
+        profiler_.phase("shortcut");
         list<Node> path_to_shortcut = dstar_planner_->getPath();
 
         list<Node> path;
@@ -532,6 +960,7 @@ int SrlDstarLite::plan(std::vector< geometry_msgs::PoseStamped > &grid_plan, geo
                 path = path_to_shortcut;
 
         /// 4. Returning the path generated
+        profiler_.phase(SMOOTHING_ON_ ? "smooth" : "poses");
         grid_plan.clear();
         grid_plan.push_back(start);
 
@@ -582,8 +1011,18 @@ int SrlDstarLite::plan(std::vector< geometry_msgs::PoseStamped > &grid_plan, geo
 
         if(path.size()>0) {
 
+                profiler_.phase("publish_path");
                 publishPath(grid_plan);
 
+                if (PLAN_REUSE_ON_ && status == PLAN_FOUND) {
+                        reuse_plan_ = grid_plan;
+                        planCells(grid_plan, reuse_path_, reuse_pose_);
+                        reuse_goal_mx_ = goal_mx;
+                        reuse_goal_my_ = goal_my;
+                        reuse_map_version_ = map_version_;
+                        reuse_valid_ = true;
+                }
+
                 return true;
         }
         else
@@ -598,26 +1037,185 @@ int SrlDstarLite::plan(std::vector< geometry_msgs::PoseStamped > &grid_plan, geo
 bool SrlDstarLite::makePlan(const geometry_msgs::PoseStamped& start,
                             const geometry_msgs::PoseStamped& goal, std::vector<geometry_msgs::PoseStamped>& plan ){
 
-        // TODO -> Implement a replanning architecture!!!!
+        if (!this->initialized_ || !ASYNC_ON_)
+                return computePlan(start, goal, plan);
+
+        /// the stored plan starts where the robot was when it was made
+        geometry_msgs::PoseStamped s = transformPose(start);
+
+        unsigned long request;
+        {
+                boost::mutex::scoped_lock lock(async_mutex_);
+                async_start_ = start;
+                async_goal_ = goal;
+                request = ++async_request_;
+                async_last_request_ = ros::WallTime::now();
+                async_cond_.notify_one();
+
+                /// the freshest plan of the planner thread, if it is for this
+                /// goal, recent enough and the robot is still on it
+                double age = (ros::WallTime::now() - async_stamp_).toSec();
+                if (async_served_ > 0 && async_found_ && age <= MAX_PLAN_AGE_ &&
+                    async_served_goal_.header.frame_id == goal.header.frame_id &&
+                    async_served_goal_.pose.position.x == goal.pose.position.x &&
+                    async_served_goal_.pose.position.y == goal.pose.position.y &&
+                    s.header.frame_id == costmap_frame_) {
+                        std::vector<geometry_msgs::PoseStamped> trimmed = async_plan_;
+                        if (trimPlan(trimmed, s)) {
+                                plan.swap(trimmed);
+                                ROS_DEBUG("D* Lite plan of map version %lu, %f s old", async_map_version_, age);
+                                return true;
+                        }
+                }
+        }
+
+        /// too old, for another goal or the robot left it: planned here,
+        /// the planner lock keeps the planner thread out meanwhile
+        ROS_DEBUG("D* Lite no plan younger than %f s for this goal and pose, planning now", MAX_PLAN_AGE_);
+        unsigned long map_version = 0;
+        bool found = computePlan(start, goal, plan, &map_version);
+        storeAsyncPlan(request, goal, plan, found, map_version);
+        return found;
+}
+
+
+/// ==================================================================================
+/// storeAsyncPlan(unsigned long request, const geometry_msgs::PoseStamped& goal,
+///                std::vector<geometry_msgs::PoseStamped>& plan, bool found, unsigned long map_version)
+/// method to keep the plan of a request as the freshest one, its poses
+/// tagged with the map version (seq) and planning time (stamp)
+/// ==================================================================================
+void SrlDstarLite::storeAsyncPlan(unsigned long request, const geometry_msgs::PoseStamped& goal,
+                                  std::vector<geometry_msgs::PoseStamped>& plan, bool found, unsigned long map_version){
+
+        ros::Time stamp = ros::Time::now();
+        for (size_t i = 0; i < plan.size(); i++) {
+                plan[i].header.seq = map_version;
+                plan[i].header.stamp = stamp;
+        }
+
+        boost::mutex::scoped_lock lock(async_mutex_);
+        /// a plan of an older request than the stored one is dropped
+        if (request < async_served_)
+                return;
+        async_plan_ = plan;
+        async_found_ = found;
+        async_stamp_ = ros::WallTime::now();
+        async_map_version_ = map_version;
+        async_served_ = request;
+        async_served_goal_ = goal;
+}
+
+
+/// ==================================================================================
+/// trimPlan(std::vector<geometry_msgs::PoseStamped>& plan, const geometry_msgs::PoseStamped& start)
+/// method to cut a plan made from an older start at the robot: the poses
+/// before the first segment passing on or next to the cell of the robot are
+/// replaced by the robot pose
+/// ==================================================================================
+bool SrlDstarLite::trimPlan(std::vector<geometry_msgs::PoseStamped>& plan, const geometry_msgs::PoseStamped& start){
+
+        double tolerance = 1.5*costmap_->getResolution();
+        double px = start.pose.position.x;
+        double py = start.pose.position.y;
+
+        for (size_t i = 1; i < plan.size(); i++) {
+                double ax = plan[i-1].pose.position.x, ay = plan[i-1].pose.position.y;
+                double dx = plan[i].pose.position.x - ax, dy = plan[i].pose.position.y - ay;
+                double len2 = dx*dx + dy*dy;
+                double t = (len2 > 0) ? ((px - ax)*dx + (py - ay)*dy)/len2 : 0;
+                t = std::min(1.0, std::max(0.0, t));
+                if (hypot(ax + t*dx - px, ay + t*dy - py) > tolerance)
+                        continue;
+
+                /// the robot pose carries the tags of the plan
+                geometry_msgs::PoseStamped first = start;
+                first.header = plan[0].header;
+                plan.erase(plan.begin(), plan.begin() + i);
+                plan.insert(plan.begin(), first);
+                return true;
+        }
+        return false;
+}
+
+
+/// ==================================================================================
+/// asyncLoop()
+/// planner thread: repairs the plan of the last makePlan request every
+/// ASYNC_PERIOD seconds, or at once for a new request
+/// ==================================================================================
+void SrlDstarLite::asyncLoop(){
+
+        while (true) {
+
+                geometry_msgs::PoseStamped start, goal;
+                unsigned long request;
+                {
+                        boost::unique_lock<boost::mutex> lock(async_mutex_);
+                        while (!async_stop_ && (async_request_ == 0 ||
+                               (ros::WallTime::now() - async_last_request_).toSec() > ASYNC_IDLE_TIME))
+                                async_cond_.wait(lock);
+                        if (!async_stop_ && async_request_ == async_served_)
+                                async_cond_.timed_wait(lock, boost::posix_time::microseconds((long)(ASYNC_PERIOD_*1e6)));
+                        if (async_stop_)
+                                return;
+                        start = async_start_;
+                        goal = async_goal_;
+                        request = async_request_;
+                }
+
+                /// computePlan holds the costmap only while it is ingested
+                std::vector<geometry_msgs::PoseStamped> plan;
+                unsigned long map_version = 0;
+                bool found = computePlan(start, goal, plan, &map_version);
+                storeAsyncPlan(request, goal, plan, found, map_version);
+        }
+}
+
+
+/// ==================================================================================
+/// computePlan()
+/// the planning pipeline of makePlan, map_version if given receives the
+/// version of the map the plan was made on
+/// ==================================================================================
+bool SrlDstarLite::computePlan(const geometry_msgs::PoseStamped& start,
+                               const geometry_msgs::PoseStamped& goal, std::vector<geometry_msgs::PoseStamped>& plan,
+                               unsigned long *map_version ){
 
 
         if(this->initialized_) {
 
+                /// the TF lookups wait up to 0.2 s each, they come before
+                /// any lock
+                ROS_DEBUG("Trasforming Goal and Start");
+                geometry_msgs::PoseStamped g = transformPose(goal);
+                geometry_msgs::PoseStamped s = transformPose(start); // TODO: make sure to have goal and start points in the cost map_ frame
+
+                /// both or none, see ingestPatch. plan() lets the costmap go
+                /// once it is ingested
+                boost::unique_lock<costmap_2d::Costmap2D::mutex_t> costmap_lock(*(costmap_->getMutex()), boost::defer_lock);
+                boost::unique_lock<boost::mutex> lock(planner_mutex_, boost::defer_lock);
+                boost::lock(costmap_lock, lock);
+
+                /// every phase of the call is timed, the cycle ends on return
+                PlanProfiler::Cycle cycle(profiler_);
+                profiler_.phase("set_goal");
                 ROS_DEBUG("Setting Goal");
-                this->setGoal((double)goal.pose.position.x, (double)goal.pose.position.y, (double)tf::getYaw(goal.pose.orientation), toll_goal_, goal.header.frame_id );
+                /// on a failed transform the former goal is kept
+                if (g.header.frame_id == costmap_frame_)
+                        this->storeGoal(g, toll_goal_);
                 /// Grid Planning
                 /// To check the frame.. Reading in Odom Frame ...
                 std::vector< geometry_msgs::PoseStamped > grid_plan;
 
-                geometry_msgs::PoseStamped s;
-
-                ROS_DEBUG("Trasforming Start");
-                s = transformPose(start); // TODO: make sure to have goal and start points in the cost map_ frame
-
-
                 ROS_DEBUG("Start To plan");
-                if(this->plan(grid_plan, s)) {
+                bool found = this->plan(grid_plan, s, costmap_lock);
+                /// the callbacks change it under the planner lock only
+                if (map_version != NULL)
+                        *map_version = map_version_;
+                if(found) {
 
+                        profiler_.phase("plan_poses");
 
                         plan.clear();
                         cnt_no_plan_= 0;
@@ -638,6 +1236,8 @@ bool SrlDstarLite::makePlan(const geometry_msgs::PoseStamped& start,
                         }
 
                         ROS_DEBUG("SRL_DSTAR_LITE Path found");
+                        profiler_.endCycle();
+                        publishDiagnostics();
                         return true;
 
                 }
@@ -645,6 +1245,8 @@ bool SrlDstarLite::makePlan(const geometry_msgs::PoseStamped& start,
                 {
                         cnt_no_plan_++;
                         ROS_WARN("NO PATH FOUND FROM THE D* Lite PLANNER");
+                        profiler_.endCycle();
+                        publishDiagnostics();
                         return false;
                 }
 
@@ -658,6 +1260,30 @@ bool SrlDstarLite::makePlan(const geometry_msgs::PoseStamped& start,
 
 
 
+/// ==================================================================================
+/// ~SrlDstarLite()
+/// stops the costmap callback thread and the planner thread
+/// ==================================================================================
+SrlDstarLite::~SrlDstarLite(){
+
+        if (!initialized_)
+                return;
+        if (costmap_spinner_ != NULL) {
+                costmap_spinner_->stop();
+                delete costmap_spinner_;
+        }
+        if (async_thread_ == NULL)
+                return;
+        {
+                boost::mutex::scoped_lock lock(async_mutex_);
+                async_stop_ = true;
+                async_cond_.notify_all();
+        }
+        async_thread_->join();
+        delete async_thread_;
+}
+
+
 /// ==================================================================================
 /// initialize()
 /// Method to initialize all the publishers and subscribers
@@ -686,6 +1312,44 @@ void SrlDstarLite::initialize(std::string name, costmap_2d::Costmap2DROS* costma
                 this->cnt_no_plan_ = 0;
                 this->SMOOTHING_ON_ = true;
                 this->SHORTCUTTING_ON_ = false;
+                this->DENSE_GRID_ON_ = true;
+                this->TILED_GRID_ON_ = false;
+                this->CONNECTIVITY_ = 8;
+                this->COST_TYPE_ = "double";
+                this->ANYTIME_ON_ = false;
+                this->EPSILON_START_ = 2.5;
+                this->EPSILON_STEP_ = 0.5;
+                this->PLANNING_TIME_ = 0.2;
+                this->SCRATCH_FRACTION_ = 0;
+                this->PROFILE_WINDOW_ = 100;
+                this->TRACE_FILE_ = "";
+                this->DIAGNOSTICS_PERIOD_ = 1.0;
+                this->RECORD_FILE_ = "";
+                this->COSTMAP_EVENTS_ON_ = false;
+                this->ROI_RADIUS_ = 0;
+                this->roi_published_ = false;
+                this->roi_x0_ = this->roi_y0_ = this->roi_x1_ = this->roi_y1_ = 0;
+                this->FIELD_RADIUS_ = 0;
+                this->PLAN_REUSE_ON_ = false;
+                this->reuse_valid_ = false;
+                this->reuse_goal_mx_ = this->reuse_goal_my_ = -1;
+                this->reuse_map_version_ = 0;
+                this->LETHAL_COST_ = COST_POSSIBLY_CIRCUMSCRIBED;
+                this->COST_SCALE_ = 1.0;
+                this->COST_EXPONENT_ = 1.0;
+                this->ASYNC_ON_ = false;
+                this->ASYNC_PERIOD_ = 0.1;
+                this->MAX_PLAN_AGE_ = 0.5;
+                this->async_thread_ = NULL;
+                this->costmap_spinner_ = NULL;
+                this->async_stop_ = false;
+                this->async_request_ = this->async_served_ = 0;
+                this->async_found_ = false;
+                this->async_map_version_ = 0;
+                this->map_version_ = 0;
+                this->costmap_events_ = false;
+                this->last_start_mx_ = this->last_start_my_ = -1;
+                this->last_goal_mx_ = this->last_goal_my_ = -1;
                 ros::NodeHandle node("~/SrlDstarLite");
                 nh_ =  node;
 
@@ -711,10 +1375,6 @@ void SrlDstarLite::initialize(std::string name, costmap_2d::Costmap2DROS* costma
 
                         world_model_ = new CostmapModel(*costmap_);
 
-                        dstar_planner_ = new Dstar();
-
-                        dstar_planner_->init(0, 0, 10, 10); // First initialization
-
                         spline_smoother_ = new PathSplineSmoother();
 
                 }
@@ -732,6 +1392,12 @@ void SrlDstarLite::initialize(std::string name, costmap_2d::Costmap2DROS* costma
 
                 pub_path_dedicated_=nh_.advertise<visualization_msgs::Marker>("dstar_path_dedicated",1000);
 
+                pub_stats_ = nh_.advertise<Dstar_lite_planning::PlannerStats>("dstar_planner_stats", 10);
+
+                pub_diagnostics_ = ros::NodeHandle().advertise<diagnostic_msgs::DiagnosticArray>("/diagnostics", 10);
+
+                pub_field_ = nh_.advertise<Dstar_lite_planning::CostField>("dstar_cost_field", 1);
+
 
                 ROS_INFO("ROS publishers and subscribers initialized");
 
@@ -757,6 +1423,86 @@ void SrlDstarLite::initialize(std::string name, costmap_2d::Costmap2DROS* costma
 
                 nh_.getParam("SMOOTHING_ON", this->SMOOTHING_ON_);
                 nh_.getParam("SHORTCUTTING_ON", this->SHORTCUTTING_ON_);
+                nh_.getParam("DENSE_GRID_ON", this->DENSE_GRID_ON_);
+                nh_.getParam("CONNECTIVITY", this->CONNECTIVITY_);
+                nh_.getParam("COST_TYPE", this->COST_TYPE_);
+
+                dstar_planner_ = makeDstar(this->CONNECTIVITY_, this->COST_TYPE_);
+                if (dstar_planner_ == NULL) {
+                        ROS_WARN("CONNECTIVITY %d with COST_TYPE %s not supported, using 8 and double",
+                                 this->CONNECTIVITY_, this->COST_TYPE_.c_str());
+                        this->CONNECTIVITY_ = 8;
+                        this->COST_TYPE_ = "double";
+                        dstar_planner_ = makeDstar(this->CONNECTIVITY_, this->COST_TYPE_);
+                }
+                nh_.getParam("TILED_GRID_ON", this->TILED_GRID_ON_);
+                dstar_planner_->setTiled(this->TILED_GRID_ON_);
+                nh_.getParam("ANYTIME_ON", this->ANYTIME_ON_);
+                nh_.getParam("EPSILON_START", this->EPSILON_START_);
+                nh_.getParam("EPSILON_STEP", this->EPSILON_STEP_);
+                nh_.getParam("PLANNING_TIME", this->PLANNING_TIME_);
+                nh_.getParam("SCRATCH_FRACTION", this->SCRATCH_FRACTION_);
+                dstar_planner_->setScratchFraction(this->SCRATCH_FRACTION_);
+                nh_.getParam("ROI_RADIUS", this->ROI_RADIUS_);
+                nh_.getParam("FIELD_RADIUS", this->FIELD_RADIUS_);
+                nh_.getParam("PLAN_REUSE_ON", this->PLAN_REUSE_ON_);
+                costmap_ingest_.trackChanges(this->PLAN_REUSE_ON_);
+                nh_.getParam("LETHAL_COST", this->LETHAL_COST_);
+                nh_.getParam("COST_SCALE", this->COST_SCALE_);
+                nh_.getParam("COST_EXPONENT", this->COST_EXPONENT_);
+                double cost_table[256];
+                CostmapIngest::costCurve(cost_table, this->LETHAL_COST_, this->COST_SCALE_, this->COST_EXPONENT_);
+                costmap_ingest_.setCostTable(cost_table);
+                nh_.getParam("PROFILE_WINDOW", this->PROFILE_WINDOW_);
+                nh_.getParam("TRACE_FILE", this->TRACE_FILE_);
+                nh_.getParam("DIAGNOSTICS_PERIOD", this->DIAGNOSTICS_PERIOD_);
+                profiler_.setWindow(this->PROFILE_WINDOW_ > 0 ? this->PROFILE_WINDOW_ : 1);
+                if (!TRACE_FILE_.empty() && !profiler_.openTrace(TRACE_FILE_))
+                        ROS_WARN("D* Lite cannot write the trace file %s", TRACE_FILE_.c_str());
+                last_diagnostics_ = ros::WallTime::now();
+                nh_.getParam("COSTMAP_EVENTS_ON", this->COSTMAP_EVENTS_ON_);
+                if (ROI_RADIUS_ > 0 && !COSTMAP_EVENTS_ON_) {
+                        /// the ROI_RADIUS plans learn the changes far from
+                        /// the robot from the published updates only
+                        double publish_frequency = 0;
+                        ros::NodeHandle("~/" + costmap_ros_->getName()).getParam("publish_frequency", publish_frequency);
+                        roi_published_ = publish_frequency > 0;
+                        if (!roi_published_)
+                                ROS_WARN("D* Lite ROI_RADIUS needs the publish_frequency of the costmap, the whole map is compared");
+                }
+                if (COSTMAP_EVENTS_ON_ || roi_published_) {
+                        /// topics published by the Costmap2DROS of the planner
+                        ros::NodeHandle costmap_nh("~/" + costmap_ros_->getName());
+                        costmap_nh.setCallbackQueue(&costmap_queue_);
+                        sub_obstacles_ = costmap_nh.subscribe("costmap", 1, &SrlDstarLite::callbackObstacles, this);
+                        sub_obstacle_updates_ = costmap_nh.subscribe("costmap_updates", 10, &SrlDstarLite::callbackObstacleUpdates, this);
+                        costmap_spinner_ = new ros::AsyncSpinner(1, &costmap_queue_);
+                }
+                nh_.getParam("RECORD_FILE", this->RECORD_FILE_);
+                if (!RECORD_FILE_.empty()) {
+                        PlanLogConfig config;
+                        config.connectivity = this->CONNECTIVITY_;
+                        config.costType = this->COST_TYPE_;
+                        config.dense = this->DENSE_GRID_ON_;
+                        config.tiled = this->TILED_GRID_ON_;
+                        config.anytime = this->ANYTIME_ON_;
+                        config.epsilonStart = this->EPSILON_START_;
+                        config.epsilonStep = this->EPSILON_STEP_;
+                        config.planningTime = this->PLANNING_TIME_;
+                        config.scratchFraction = this->SCRATCH_FRACTION_;
+                        config.costLethal = this->LETHAL_COST_;
+                        config.costScale = this->COST_SCALE_;
+                        config.costExponent = this->COST_EXPONENT_;
+                        if (recorder_.open(RECORD_FILE_, config)) {
+                                costmap_ingest_.setRecorder(&recorder_);
+                                ROS_INFO("D* Lite recording the planner inputs to %s", RECORD_FILE_.c_str());
+                        } else {
+                                ROS_WARN("D* Lite cannot write the record file %s", RECORD_FILE_.c_str());
+                        }
+                }
+                if (ANYTIME_ON_)
+                        dstar_planner_->setAnytime(this->EPSILON_START_, this->EPSILON_STEP_);
+                dstar_planner_->init(0, 0, 10, 10); // First initialization
                 /// store dim of scene
                 this->xscene_ = x2-x1;
                 this->yscene_ = y2-y1;
@@ -771,6 +1517,19 @@ void SrlDstarLite::initialize(std::string name, costmap_2d::Costmap2DROS* costma
                 ROS_INFO("Current size of the footprint %d", size_footprint);
 
                 initialized_ = true;
+
+                /// the planner is set up, the costmap callbacks may come in
+                if (costmap_spinner_ != NULL)
+                        costmap_spinner_->start();
+
+                nh_.getParam("ASYNC_ON", this->ASYNC_ON_);
+                nh_.getParam("ASYNC_PERIOD", this->ASYNC_PERIOD_);
+                nh_.getParam("MAX_PLAN_AGE", this->MAX_PLAN_AGE_);
+                if (ASYNC_ON_) {
+                        ROS_INFO("D* Lite planner thread, repairing every %f s, plans kept %f s",
+                                 this->ASYNC_PERIOD_, this->MAX_PLAN_AGE_);
+                        async_thread_ = new boost::thread(boost::bind(&SrlDstarLite::asyncLoop, this));
+                }
         }else{
 
 